@@ -1,15 +1,37 @@
 from flask import Flask, request, jsonify
 from flask_socketio import SocketIO
 import sqlite3
-import shutil
 import json
 import threading
 import os
+from datetime import datetime, timezone, timedelta
 
 app = Flask(__name__)
 socketio = SocketIO(app)
 local_storage = threading.local()
 
+# Cơ sở dữ liệu lưu dấu thời gian dạng mili giây epoch (UTC). API vẫn nhận và trả chuỗi
+# "YYYY-MM-DD HH:MM:SS" theo giờ Việt Nam (UTC+7) như trước.
+API_TIMEZONE = timezone(timedelta(hours=7))
+TIMESTAMP_FORMAT = '%Y-%m-%d %H:%M:%S'
+
+
+def to_epoch_ms(value):
+    if value is None:
+        return None
+    if isinstance(value, (int, float)):
+        return int(value)
+    parsed = datetime.fromisoformat(value)
+    if parsed.tzinfo is None:
+        parsed = parsed.replace(tzinfo=API_TIMEZONE)
+    return int(parsed.timestamp() * 1000)
+
+
+def format_epoch_ms(value):
+    if value is None:
+        return None
+    return datetime.fromtimestamp(value / 1000, API_TIMEZONE).strftime(TIMESTAMP_FORMAT)
+
 
 def get_db_connection():
     if not hasattr(local_storage, 'conn'):
@@ -34,7 +56,7 @@ def add_sensor_data():
         air_humidity = data['air_humidity']
         soil_humidity = data['soil_humidity']
         prediction = data['prediction']
-        timestamp = data['timestamp']
+        timestamp = to_epoch_ms(data['timestamp'])
         note = data['note']
 
         conn = get_db_connection()
@@ -63,7 +85,7 @@ def update_sensor_data(sensor_id):
             'air_humidity': data.get('air_humidity'),
             'soil_humidity': data.get('soil_humidity'),
             'prediction': data.get('prediction'),
-            'timestamp': data.get('timestamp'),
+            'timestamp': to_epoch_ms(data.get('timestamp')),
             'note': data.get('note')
         }
 
@@ -86,14 +108,53 @@ def update_sensor_data(sensor_id):
         return jsonify({'error': str(e)}), 400
 
 
+SENSOR_COLUMNS = ("id, device_id, light_intensity, temperature, air_humidity, soil_humidity, prediction, "
+                  "timestamp, note, valid_until, repeat_count")
+
+
+def expand_runs(rows, from_ms=None, to_ms=None):
+    # Một hàng của chế độ chỉ lưu thay đổi là một run repeat_count bản ghi giống nhau, bản đầu ở timestamp và
+    # bản cuối ở valid_until; dấu thời gian của các bản ở giữa được chia đều (cùng id). Chỉ trả các bản ghi
+    # nằm trong [from_ms, to_ms] nếu có.
+    for row in rows:
+        start, valid_until, count = row[7], row[9], row[10] or 1
+        for k in range(count):
+            if k == 0 or valid_until is None:
+                timestamp = start
+            else:
+                timestamp = start + (valid_until - start) * k // (count - 1)
+            if (from_ms is not None and timestamp < from_ms) or (to_ms is not None and timestamp > to_ms):
+                continue
+            yield row[:7] + (timestamp, row[8])
+
+
 @app.route('/get_sensor_data', methods=['GET'])
 def get_sensor_data():
     try:
         conn = get_db_connection()
         cursor = conn.cursor()
 
-        cursor.execute("SELECT * FROM sensor_data")
-        data = cursor.fetchall()
+        # Tùy chọn ?device_id=...&from=...&to=... (thời gian như các API khác). Các run được lọc theo khoảng
+        # trước rồi mới trải ra, nên truy vấn theo thiết bị chỉ đọc các hàng của khoảng đó qua chỉ mục
+        # (device_id, timestamp): các hàng bắt đầu trong khoảng, cộng run duy nhất bắt đầu trước from mà còn
+        # kéo dài vào khoảng (run của một thiết bị không chồng nhau).
+        device_id = request.args.get('device_id')
+        from_ms = to_epoch_ms(request.args.get('from'))
+        to_ms = to_epoch_ms(request.args.get('to'))
+        if device_id is None:
+            cursor.execute(f"SELECT {SENSOR_COLUMNS} FROM sensor_data "
+                           "WHERE (? IS NULL OR timestamp <= ?) AND (? IS NULL OR COALESCE(valid_until, timestamp) >= ?) "
+                           "ORDER BY id", (to_ms, to_ms, from_ms, from_ms))
+        else:
+            lower = from_ms if from_ms is not None else -(1 << 63)
+            upper = to_ms if to_ms is not None else (1 << 63) - 1
+            cursor.execute(
+                f"SELECT * FROM (SELECT {SENSOR_COLUMNS} FROM sensor_data WHERE device_id = ? AND timestamp < ? "
+                "ORDER BY timestamp DESC LIMIT 1) WHERE valid_until >= ? "
+                f"UNION ALL SELECT {SENSOR_COLUMNS} FROM sensor_data "
+                "WHERE device_id = ? AND timestamp BETWEEN ? AND ? ORDER BY timestamp",
+                (device_id, lower, lower, device_id, lower, upper))
+        data = expand_runs(cursor, from_ms, to_ms)
 
         sensor_data_list = []
         for row in data:
@@ -105,7 +166,7 @@ def get_sensor_data():
                 'air_humidity': row[4],
                 'soil_humidity': row[5],
                 'prediction': row[6],
-                'timestamp': row[7],
+                'timestamp': format_epoch_ms(row[7]),
                 'note': row[8]
             }
             sensor_data_list.append(sensor_data)
@@ -121,7 +182,13 @@ def backup_database():
         src_file = 'F:/Source/C++/Database_Server/cmake-build-debug/lora.db'
         backup_file = 'backup/lora_backup.db'
 
-        shutil.copy(src_file, backup_file)
+        # lora.db chạy ở chế độ WAL: chép riêng tệp .db sẽ thiếu các giao dịch còn nằm trong lora.db-wal.
+        src = sqlite3.connect(src_file)
+        dst = sqlite3.connect(backup_file)
+        with dst:
+            src.backup(dst)
+        dst.close()
+        src.close()
 
         return jsonify({'message': 'Database backup created successfully!'}), 200
     except Exception as e:
@@ -134,13 +201,13 @@ def add_user_control():
         data = request.get_json()
         device_id = data['device_id']
         command = data['command']
-        timestamp_utc7 = data['timestamp']
+        timestamp = to_epoch_ms(data['timestamp'])
 
         conn = get_db_connection()
         cursor = conn.cursor()
 
         cursor.execute("INSERT INTO user_control (device_id, command, timestamp) VALUES (?, ?, ?)",
-                       (device_id, command, timestamp_utc7))
+                       (device_id, command, timestamp))
         conn.commit()
 
         return jsonify({'message': 'User control data added successfully!'}), 201
@@ -163,7 +230,7 @@ def get_user_control():
                 'id': row[0],
                 'device_id': row[1],
                 'command': row[2],
-                'timestamp': row[3]
+                'timestamp': format_epoch_ms(row[3])
             }
             user_control_list.append(user_control_data)
 
@@ -180,7 +247,7 @@ def update_user_control(user_control_id):
         fields_to_update = {
             'device_id': data.get('device_id'),
             'command': data.get('command'),
-            'timestamp': data.get('timestamp')
+            'timestamp': to_epoch_ms(data.get('timestamp'))
         }
 
         update_query = ", ".join([f"{field} = ?" for field in fields_to_update.keys()])
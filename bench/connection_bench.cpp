@@ -0,0 +1,109 @@
+// Công cụ đo tải kết nối cho LoRaServer: nhiều luồng client liên tục mở kết nối TCP,
+// gửi một hoặc nhiều bản ghi "device_id:l t a s\n", đóng chiều gửi và chờ máy chủ đóng kết nối.
+// In ra số kết nối/giây, số bản ghi/giây và độ trễ p50/p99 (từ lúc connect đến lúc nhận EOF).
+//
+// Cách dùng: connection_bench <host> <port> [clients=32] [seconds=10] [records_per_connection=1]
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+using bench_clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <host> <port> [clients=32] [seconds=10] [records_per_connection=1]" << std::endl;
+        return 1;
+    }
+
+    const std::string host = argv[1];
+    const std::string port = argv[2];
+    const int clients = argc > 3 ? std::atoi(argv[3]) : 32;
+    const int seconds = argc > 4 ? std::atoi(argv[4]) : 10;
+    const int records_per_connection = argc > 5 ? std::max(1, std::atoi(argv[5])) : 1;
+
+    std::atomic<bool> running{true};
+    std::atomic<long> failures{0};
+    std::mutex latencies_mutex;
+    std::vector<double> latencies_us; // Độ trễ của từng kết nối thành công, tính bằng micro giây.
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            boost::asio::io_context io;
+            tcp::resolver resolver(io);
+            auto endpoints = resolver.resolve(host, port);
+            const std::string record = "bench-" + std::to_string(c) + ":1700 25 60 65\n";
+            std::string message;
+            for (int r = 0; r < records_per_connection; ++r) {
+                message += record;
+            }
+            std::vector<double> local;
+
+            while (running.load(std::memory_order_relaxed)) {
+                auto begin = bench_clock::now();
+                boost::system::error_code error;
+                tcp::socket socket(io);
+                boost::asio::connect(socket, endpoints, error);
+                if (!error) {
+                    boost::asio::write(socket, boost::asio::buffer(message), error);
+                }
+                if (!error) {
+                    socket.shutdown(tcp::socket::shutdown_send, error); // Báo cho máy chủ rằng không còn bản ghi nào.
+                }
+                if (!error) {
+                    // Đọc cho đến khi máy chủ đóng kết nối.
+                    char sink[64];
+                    while (!error) {
+                        socket.read_some(boost::asio::buffer(sink), error);
+                    }
+                    if (error == boost::asio::error::eof || error == boost::asio::error::connection_reset) {
+                        error = {};
+                    }
+                }
+
+                if (error) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                local.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - begin).count());
+            }
+
+            std::lock_guard<std::mutex> lock(latencies_mutex);
+            latencies_us.insert(latencies_us.end(), local.begin(), local.end());
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (latencies_us.empty()) {
+        std::cerr << "No successful connections (" << failures << " failures)." << std::endl;
+        return 1;
+    }
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    auto percentile = [&](double p) {
+        return latencies_us[static_cast<size_t>(p * static_cast<double>(latencies_us.size() - 1))];
+    };
+
+    std::cout << "clients=" << clients << " seconds=" << seconds
+              << " records_per_connection=" << records_per_connection << std::endl;
+    std::cout << "connections: " << latencies_us.size() << " ok, " << failures << " failed" << std::endl;
+    std::cout << "connections/sec: " << static_cast<double>(latencies_us.size()) / seconds << std::endl;
+    std::cout << "records/sec: "
+              << static_cast<double>(latencies_us.size()) * records_per_connection / seconds << std::endl;
+    std::cout << "latency p50: " << percentile(0.50) << " us, p99: " << percentile(0.99) << " us" << std::endl;
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Đo tranh chấp trên danh bạ thiết bị: std::map với một mutex chung (find rồi operator[], như trước khi có
+// DeviceRegistry) so với DeviceRegistry chia shard, với 1, 2, 4... luồng. Mỗi luồng liên tục ghi bản ghi
+// vào DeviceHistory của một thiết bị ngẫu nhiên; read_percent phần trăm thao tác là đọc bản ghi mới nhất
+// (như QUERY LATEST). Thông lượng chỉ tăng theo số luồng khi máy có đủ lõi.
+//
+// Cách dùng: device_registry_bench [seconds_per_run=2] [max_threads=8] [devices=10000] [read_percent=10] [shards=64]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "device_history.h"
+#include "device_registry.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t kHistorySize = 360;
+
+struct Device {
+    Device() : history(kHistorySize, 0) {}
+    DeviceHistory history;
+};
+
+// Danh bạ cũ: một mutex cho mọi thiết bị.
+class GlobalMapRegistry {
+public:
+    void append(const std::string& device_id, const SensorData& data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (devices_.find(device_id) != devices_.end()) {
+            devices_[device_id].history.append(data);
+        } else {
+            devices_[device_id] = Device();
+            devices_[device_id].history.append(data);
+        }
+    }
+
+    bool latest(const std::string& device_id, SensorData& out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = devices_.find(device_id);
+        return it != devices_.end() && it->second.history.latest(out);
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, Device> devices_;
+};
+
+class ShardedRegistry {
+public:
+    explicit ShardedRegistry(std::size_t shards) : devices_([](const std::string&) { return Device(); }, shards) {}
+
+    void append(const std::string& device_id, const SensorData& data) {
+        devices_.update(device_id, [&](Device& device) { device.history.append(data); });
+    }
+
+    bool latest(const std::string& device_id, SensorData& out) {
+        bool found = false;
+        devices_.read(device_id, [&](const Device& device) { found = device.history.latest(out); });
+        return found;
+    }
+
+private:
+    DeviceRegistry<Device> devices_;
+};
+
+// threads luồng thao tác liên tục trong seconds giây trên registry. Trả về số thao tác/giây.
+template <typename Registry>
+double run(Registry& registry, const std::vector<std::string>& device_ids, std::size_t threads, int seconds, int read_percent) {
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> total{0};
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 rng(static_cast<unsigned>(t + 1));
+            std::uniform_int_distribution<std::size_t> pick(0, device_ids.size() - 1);
+            std::uniform_int_distribution<int> percent(0, 99);
+            SensorData data;
+            data.light_intensity = 1700;
+            data.temperature = 25;
+            data.air_humidity = 60;
+            data.soil_humidity = 65;
+            data.prediction = "good";
+            std::uint64_t ops = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const std::string& device_id = device_ids[pick(rng)];
+                if (percent(rng) < read_percent) {
+                    SensorData latest;
+                    registry.latest(device_id, latest);
+                } else {
+                    data.timestamp_ms += 10000;
+                    registry.append(device_id, data);
+                }
+                ++ops;
+            }
+            total.fetch_add(ops, std::memory_order_relaxed);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop.store(true);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return static_cast<double>(total.load()) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int seconds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2;
+    std::size_t max_threads = argc > 2 ? std::max(1ul, std::strtoul(argv[2], nullptr, 10)) : 8;
+    std::size_t devices = argc > 3 ? std::max(1ul, std::strtoul(argv[3], nullptr, 10)) : 10000;
+    int read_percent = argc > 4 ? std::clamp(std::atoi(argv[4]), 0, 100) : 10;
+    std::size_t shards = argc > 5 ? std::max(1ul, std::strtoul(argv[5], nullptr, 10)) : DeviceRegistry<Device>::kDefaultShards;
+
+    std::vector<std::string> device_ids;
+    for (std::size_t i = 0; i < devices; ++i) {
+        device_ids.push_back("device-" + std::to_string(i));
+    }
+
+    std::cout << devices << " devices, " << read_percent << "% reads, " << seconds << " s per run, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    double global_base = 0;
+    double sharded_base = 0;
+    for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+        GlobalMapRegistry global;
+        ShardedRegistry sharded(shards);
+        double global_ops = run(global, device_ids, threads, seconds, read_percent);
+        double sharded_ops = run(sharded, device_ids, threads, seconds, read_percent);
+        if (threads == 1) {
+            global_base = global_ops;
+            sharded_base = sharded_ops;
+        }
+        std::cout << threads << " threads: map+mutex " << global_ops << " ops/s (x" << global_ops / global_base
+                  << "), sharded " << sharded_ops << " ops/s (x" << sharded_ops / sharded_base << ")" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Đo tốc độ ghi bền vững vào sensor_data trên cùng một ổ đĩa: mỗi bản ghi một giao dịch (như trước khi có
+// group commit) so với group commit N bản ghi mỗi giao dịch. Dùng cùng schema, câu INSERT và chế độ
+// hồ sơ lưu trữ như máy chủ, nên mỗi giao dịch tốn các lần fsync như thật.
+//
+// Cách dùng: group_commit_bench <db_path> [seconds_per_mode=5] [batch_sizes=1,16,128,512] [profile=durable]
+// profile là durable, balanced, throughput hoặc rollback (journal mặc định của SQLite, như trước khi có hồ sơ).
+// db_path nên nằm trên cùng ổ đĩa với lora.db; tệp sẽ bị xóa và tạo lại.
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sqlite_connection.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr const char* kSchema = "CREATE TABLE IF NOT EXISTS sensor_data ("
+                                "id INTEGER PRIMARY KEY AUTOINCREMENT, device_id TEXT, light_intensity REAL, "
+                                "temperature REAL, air_humidity REAL, soil_humidity REAL, prediction TEXT, "
+                                "timestamp INTEGER, note TEXT);";
+
+constexpr const char* kInsert = "INSERT INTO sensor_data (device_id, light_intensity, temperature, air_humidity, "
+                                "soil_humidity, timestamp, prediction, note) VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+
+// Ghi liên tục trong khoảng seconds giây, mỗi giao dịch batch bản ghi. Trả về số bản ghi/giây.
+double run_mode(sqlite3* db, sqlite3_stmt* stmt, std::size_t batch, int seconds) {
+    const auto begin = bench_clock::now();
+    const auto end = begin + std::chrono::seconds(seconds);
+    std::size_t rows = 0;
+
+    while (bench_clock::now() < end) {
+        if (batch > 1) {
+            sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+        }
+        for (std::size_t i = 0; i < batch; ++i) {
+            sqlite3_bind_text(stmt, 1, "bench-device", -1, SQLITE_STATIC);
+            sqlite3_bind_double(stmt, 2, 1700);
+            sqlite3_bind_double(stmt, 3, 25);
+            sqlite3_bind_double(stmt, 4, 60);
+            sqlite3_bind_double(stmt, 5, 65);
+            sqlite3_bind_int64(stmt, 6, 1704067200000); // 2024-01-01 00:00:00 UTC.
+            sqlite3_bind_text(stmt, 7, "Normal", -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 8, "", -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                std::cerr << "insert failed: " << sqlite3_errmsg(db) << std::endl;
+                std::exit(1);
+            }
+            sqlite3_reset(stmt);
+        }
+        if (batch > 1 && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            std::cerr << "commit failed: " << sqlite3_errmsg(db) << std::endl;
+            std::exit(1);
+        }
+        rows += batch;
+    }
+
+    return static_cast<double>(rows) / std::chrono::duration<double>(bench_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <db_path> [seconds_per_mode=5] [batch_sizes=1,16,128,512] [profile=durable]"
+                  << std::endl;
+        return 1;
+    }
+    const std::string path = argv[1];
+    const int seconds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+
+    std::vector<std::size_t> batch_sizes;
+    std::stringstream sizes(argc > 3 ? argv[3] : "1,16,128,512");
+    for (std::string size; std::getline(sizes, size, ',');) {
+        batch_sizes.push_back(std::max<std::size_t>(1, std::strtoul(size.c_str(), nullptr, 10)));
+    }
+
+    const std::string profile_name = argc > 4 ? argv[4] : "durable";
+    std::optional<StorageProfile> profile = parse_storage_profile(profile_name);
+    if (!profile && profile_name != "rollback") {
+        std::cerr << "Unknown profile: " << profile_name << std::endl;
+        return 1;
+    }
+
+    for (const char* suffix : {"", "-journal", "-wal", "-shm"}) {
+        std::remove((path + suffix).c_str());
+    }
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK || sqlite3_exec(db, kSchema, nullptr, nullptr, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open " << path << ": " << sqlite3_errmsg(db) << std::endl;
+        return 1;
+    }
+    if (profile) {
+        StorageSettings settings = StorageSettings::for_profile(*profile);
+        std::string pragmas = "PRAGMA journal_mode=" + std::string(settings.journal_mode) + ";PRAGMA synchronous=" +
+                              settings.synchronous + ";PRAGMA mmap_size=" + std::to_string(settings.mmap_size) +
+                              ";PRAGMA cache_size=" + std::to_string(settings.cache_size) + ";";
+        sqlite3_exec(db, pragmas.c_str(), nullptr, nullptr, nullptr);
+    }
+    std::cout << "profile: " << profile_name << std::endl;
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, kInsert, -1, &stmt, nullptr);
+
+    double baseline = 0;
+    for (std::size_t batch : batch_sizes) {
+        double rate = run_mode(db, stmt, batch, seconds);
+        if (baseline == 0) {
+            baseline = rate;
+        }
+        std::cout << "rows/commit=" << batch << ": " << rate << " rows/s (" << rate / baseline << "x)" << std::endl;
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return 0;
+}
@@ -0,0 +1,155 @@
+// So sánh tầng I/O của LoRaServer (--io-backend=asio và --io-backend=uring): nhiều client giữ kết nối
+// lâu dài và gửi liên tục bản ghi "device_id:l t a s\n" trong khoảng thời gian cho trước, hoặc kết nối lại
+// sau mỗi records_per_connection bản ghi để tính cả accept/close. In ra số bản ghi/giây.
+//
+// Nếu truyền server_pid, công cụ đọc /proc/<pid>/io trước và sau khi đo để in số lời gọi hệ thống loại
+// đọc/ghi (syscr/syscw: read, recv, write, send, ...) trên mỗi bản ghi. Thao tác mà io_uring thực hiện bên
+// trong nhân không được tính vào hai bộ đếm này, vì vậy để có tổng số lời gọi hệ thống (cả accept, close,
+// openat, io_uring_enter, epoll_wait) hãy chạy máy chủ dưới `strace -c -f` hoặc
+// `perf stat -e raw_syscalls:sys_enter -p <pid>`, rồi đối chiếu với dòng "[metrics] uring" của máy chủ.
+// Chạy máy chủ với --overload-policy=drop để SQLite không làm chậm việc đọc từ socket.
+//
+// Cách dùng: io_backend_bench <host> <port> [clients=32] [seconds=10] [records_per_connection=0] [server_pid=0]
+//            records_per_connection = 0: mỗi client chỉ dùng một kết nối suốt lần đo.
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+struct ProcessIo {
+    unsigned long long syscr = 0;
+    unsigned long long syscw = 0;
+};
+
+// Đọc bộ đếm lời gọi hệ thống đọc/ghi của tiến trình; trả về false nếu không đọc được.
+bool read_process_io(int pid, ProcessIo& io) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/io");
+    std::string key;
+    unsigned long long value;
+    bool found = false;
+    while (in >> key >> value) {
+        if (key == "syscr:") {
+            io.syscr = value;
+            found = true;
+        } else if (key == "syscw:") {
+            io.syscw = value;
+        }
+    }
+    return found;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <host> <port> [clients=32] [seconds=10] [records_per_connection=0] [server_pid=0]" << std::endl;
+        return 1;
+    }
+
+    const std::string host = argv[1];
+    const std::string port = argv[2];
+    const int clients = argc > 3 ? std::atoi(argv[3]) : 32;
+    const int seconds = argc > 4 ? std::max(1, std::atoi(argv[4])) : 10;
+    const long records_per_connection = argc > 5 ? std::atol(argv[5]) : 0;
+    const int server_pid = argc > 6 ? std::atoi(argv[6]) : 0;
+
+    constexpr int kRecordsPerWrite = 16; // Mỗi lần ghi của client chứa nhiều bản ghi, như gateway gửi dồn.
+
+    std::atomic<bool> running{true};
+    std::atomic<unsigned long long> records{0};
+    std::atomic<unsigned long long> connections{0};
+    std::atomic<unsigned long long> failures{0};
+
+    ProcessIo io_before;
+    bool have_io = server_pid > 0 && read_process_io(server_pid, io_before);
+    const auto begin = bench_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            boost::asio::io_context io;
+            tcp::resolver resolver(io);
+            auto endpoints = resolver.resolve(host, port);
+            const std::string record = "bench-" + std::to_string(c) + ":1700 25 60 65\n";
+            std::string chunk;
+            for (int r = 0; r < kRecordsPerWrite; ++r) {
+                chunk += record;
+            }
+
+            while (running.load(std::memory_order_relaxed)) {
+                boost::system::error_code error;
+                tcp::socket socket(io);
+                boost::asio::connect(socket, endpoints, error);
+                if (error) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                connections.fetch_add(1, std::memory_order_relaxed);
+
+                long sent = 0;
+                while (running.load(std::memory_order_relaxed) &&
+                       (records_per_connection == 0 || sent < records_per_connection)) {
+                    long count = kRecordsPerWrite;
+                    if (records_per_connection != 0) {
+                        count = std::min<long>(count, records_per_connection - sent);
+                    }
+                    boost::asio::write(socket, boost::asio::buffer(chunk.data(), record.size() * count), error);
+                    if (error) {
+                        break;
+                    }
+                    sent += count;
+                    records.fetch_add(static_cast<unsigned long long>(count), std::memory_order_relaxed);
+                }
+                if (error) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                if (!running.load(std::memory_order_relaxed)) {
+                    break; // Hết giờ: không chờ máy chủ xử lý nốt phần còn trong hàng đợi.
+                }
+
+                // Đóng chiều gửi và chờ máy chủ đóng kết nối, để accept/close cũng được tính.
+                socket.shutdown(tcp::socket::shutdown_send, error);
+                char sink[64];
+                while (!error) {
+                    socket.read_some(boost::asio::buffer(sink), error);
+                }
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(bench_clock::now() - begin).count();
+
+    std::cout << "clients=" << clients << " seconds=" << seconds
+              << " records_per_connection=" << records_per_connection << std::endl;
+    std::cout << "records: " << records << ", connections: " << connections << ", failures: " << failures << std::endl;
+    std::cout << "records/sec: " << static_cast<double>(records) / elapsed << std::endl;
+
+    ProcessIo io_after;
+    if (have_io && read_process_io(server_pid, io_after) && records > 0) {
+        auto reads = io_after.syscr - io_before.syscr;
+        auto writes = io_after.syscw - io_before.syscw;
+        std::cout << "server read syscalls: " << reads << " (" << static_cast<double>(reads) / records << "/record)"
+                  << ", write syscalls: " << writes << " (" << static_cast<double>(writes) / records << "/record)"
+                  << std::endl;
+    }
+    return 0;
+}
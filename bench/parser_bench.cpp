@@ -0,0 +1,117 @@
+// Đo tốc độ phân tích bản ghi văn bản: ReadingParser (string_view + from_chars) so với đường cũ
+// (sao chép chuỗi + sscanf). Bản ghi được dựng lại từ các dòng "Received data from device ..." trong
+// log.txt của máy chủ rồi lặp lại cho đủ số lượng yêu cầu.
+//
+// Cách dùng: parser_bench <log.txt> [records=5000000]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "reading_parser.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+// Dựng lại "id:l t a s" từ một dòng log; trả về false nếu dòng không đúng mẫu.
+bool record_from_log_line(const std::string& line, std::string& record) {
+    static constexpr std::string_view kPrefix = "Received data from device ";
+    if (line.compare(0, kPrefix.size(), kPrefix) != 0) {
+        return false;
+    }
+    std::size_t colon = line.find(": Light Intensity: ", kPrefix.size());
+    if (colon == std::string::npos) {
+        return false;
+    }
+
+    double values[4];
+    if (std::sscanf(line.c_str() + colon, ": Light Intensity: %lf, Temperature: %lf, Air Humidity: %lf, Soil Humidity: %lf",
+                    &values[0], &values[1], &values[2], &values[3]) != 4) {
+        return false;
+    }
+    char text[128];
+    std::snprintf(text, sizeof(text), "%g %g %g %g", values[0], values[1], values[2], values[3]); // Như ostream ghi vào log.
+    record = line.substr(kPrefix.size(), colon - kPrefix.size()) + ":" + text;
+    return true;
+}
+
+// Đường phân tích cũ của handle_request: tách chuỗi bằng substr rồi gọi sscanf.
+bool parse_with_sscanf(std::string_view data, std::string& device_id, double values[4]) {
+    std::string copy(data);
+    size_t pos = copy.find(':');
+    if (pos == std::string::npos) {
+        return false;
+    }
+    device_id = copy.substr(0, pos);
+    std::string sensor_data_str = copy.substr(pos + 1);
+    return std::sscanf(sensor_data_str.c_str(), "%lf %lf %lf %lf", &values[0], &values[1], &values[2], &values[3]) == 4;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <log.txt> [records=5000000]" << std::endl;
+        return 1;
+    }
+    const std::size_t target = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5000000;
+
+    std::vector<std::string> unique;
+    std::ifstream log(argv[1]);
+    std::string line;
+    std::string record;
+    while (std::getline(log, line)) {
+        if (record_from_log_line(line, record)) {
+            unique.push_back(record);
+        }
+    }
+    if (unique.empty()) {
+        std::cerr << "No readings found in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> records;
+    records.reserve(target);
+    while (records.size() < target) {
+        records.push_back(unique[records.size() % unique.size()]);
+    }
+    std::cout << "records: " << records.size() << " (" << unique.size() << " distinct lines from log)" << std::endl;
+
+    double checksum = 0; // Ngăn trình biên dịch bỏ qua phần tính toán.
+    std::size_t failures = 0;
+
+    auto begin = bench_clock::now();
+    std::string device_id;
+    double values[4];
+    for (const std::string& r : records) {
+        if (parse_with_sscanf(r, device_id, values)) {
+            checksum += values[0] + static_cast<double>(device_id.size());
+        } else {
+            ++failures;
+        }
+    }
+    double sscanf_ns = std::chrono::duration<double, std::nano>(bench_clock::now() - begin).count();
+
+    begin = bench_clock::now();
+    ReadingParser::Reading reading;
+    for (const std::string& r : records) {
+        if (ReadingParser::parse(r, reading)) {
+            checksum += reading.values[0] + static_cast<double>(reading.device_id.size());
+        } else {
+            ++failures;
+        }
+    }
+    double parser_ns = std::chrono::duration<double, std::nano>(bench_clock::now() - begin).count();
+
+    auto n = static_cast<double>(records.size());
+    std::cout << "sscanf:        " << sscanf_ns / n << " ns/record, " << n / sscanf_ns * 1e3 << " M records/s" << std::endl;
+    std::cout << "ReadingParser: " << parser_ns / n << " ns/record, " << n / parser_ns * 1e3 << " M records/s" << std::endl;
+    std::cout << "speedup: " << sscanf_ns / parser_ns << "x (failures=" << failures << ", checksum=" << checksum << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,201 @@
+// Đo truy vấn đọc song song với luồng ghi trên cùng lora.db: mỗi truy vấn mở kết nối riêng (như api.py và
+// DatabaseWatcher của test.py) so với SqliteReadPool (kết nối chỉ đọc mở sẵn, câu lệnh biên dịch sẵn), với
+// 1, 2, 4... luồng đọc. Trong lúc đó một luồng ghi group commit commit_rows bản ghi mỗi giao dịch với hồ sơ
+// durable như máy chủ; độ trễ commit của nó cho thấy người đọc có làm chậm việc ghi hay không.
+//
+// Cách dùng: read_pool_bench <db_path> [seconds_per_run=3] [max_readers=8] [devices=200] [readings_per_device=2000] [commit_rows=512]
+// Mỗi truy vấn lấy 1 giờ (360 bản ghi) của một thiết bị ngẫu nhiên. db_path sẽ bị xóa và tạo lại.
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sqlite_connection.h"
+#include "sqlite_read_pool.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::int64_t kStartMs = 1704067200000; // 2024-01-01 00:00:00 UTC.
+constexpr std::int64_t kIntervalMs = 10000;
+constexpr std::int64_t kQueryWindowMs = 60 * 60 * 1000;
+
+constexpr const char* kInsert = "INSERT INTO sensor_data (device_id, light_intensity, temperature, air_humidity, "
+                                "soil_humidity, timestamp, prediction, note) VALUES (?, ?, ?, ?, ?, ?, 'good', '')";
+constexpr const char* kSelect = "SELECT timestamp, light_intensity, temperature, air_humidity, soil_humidity, prediction "
+                                "FROM sensor_data WHERE device_id = ? AND timestamp BETWEEN ? AND ? ORDER BY timestamp";
+
+struct Options {
+    std::string path;
+    int seconds = 3;
+    std::size_t max_readers = 8;
+    std::size_t devices = 200;
+    std::size_t per_device = 2000;
+    std::size_t commit_rows = 512;
+};
+
+void insert_rows(SqliteConnection& db, std::size_t devices, std::size_t first_index, std::size_t count) {
+    Statement insert(db, kInsert);
+    for (std::size_t i = first_index; i < first_index + count; ++i) {
+        std::string device_id = "device-" + std::to_string(i % devices);
+        sqlite3_bind_text(insert.get(), 1, device_id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(insert.get(), 2, 1700);
+        sqlite3_bind_double(insert.get(), 3, 25);
+        sqlite3_bind_double(insert.get(), 4, 60);
+        sqlite3_bind_double(insert.get(), 5, 65);
+        sqlite3_bind_int64(insert.get(), 6, kStartMs + static_cast<std::int64_t>(i / devices) * kIntervalMs);
+        sqlite3_step(insert.get());
+        insert.reset();
+    }
+}
+
+// Lấy 1 giờ bản ghi của device_id bắt đầu từ from; trả về số hàng.
+std::size_t run_query(sqlite3_stmt* stmt, const std::string& device_id, std::int64_t from) {
+    sqlite3_bind_text(stmt, 1, device_id.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, from);
+    sqlite3_bind_int64(stmt, 3, from + kQueryWindowMs - 1);
+    std::size_t rows = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ++rows;
+    }
+    sqlite3_reset(stmt);
+    return rows;
+}
+
+struct Result {
+    double queries_per_second = 0;
+    double commit_p50_ms = 0;
+    double commit_p99_ms = 0;
+};
+
+// readers luồng truy vấn liên tục trong seconds giây, song song với luồng ghi. pooled = dùng SqliteReadPool.
+Result run(const Options& options, SqliteReadPool& pool, std::size_t readers, bool pooled, std::size_t& next_index) {
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> queries{0};
+    std::vector<double> commit_ms;
+
+    std::thread writer([&]() {
+        SqliteConnection db(options.path);
+        db.open();
+        db.configure(StorageSettings::for_profile(StorageProfile::Durable));
+        while (!stop.load(std::memory_order_relaxed)) {
+            auto begin = bench_clock::now();
+            db.exec("BEGIN;");
+            insert_rows(db, options.devices, next_index, options.commit_rows);
+            db.exec("COMMIT;");
+            next_index += options.commit_rows;
+            commit_ms.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - begin).count());
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (std::size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r]() {
+            std::mt19937 rng(static_cast<unsigned>(r + 1));
+            std::uniform_int_distribution<std::size_t> pick_device(0, options.devices - 1);
+            std::uniform_int_distribution<std::int64_t> pick_start(
+                    kStartMs, kStartMs + static_cast<std::int64_t>(options.per_device) * kIntervalMs - kQueryWindowMs);
+            std::uint64_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                std::string device_id = "device-" + std::to_string(pick_device(rng));
+                std::int64_t from = pick_start(rng);
+                if (pooled) {
+                    pool.read([&](SqliteConnection& db) {
+                        Statement select(db, kSelect);
+                        run_query(select.get(), device_id, from);
+                    });
+                } else {
+                    sqlite3* db = nullptr;
+                    sqlite3_stmt* select = nullptr;
+                    sqlite3_open_v2(options.path.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr);
+                    sqlite3_busy_timeout(db, 5000);
+                    sqlite3_prepare_v2(db, kSelect, -1, &select, nullptr);
+                    run_query(select, device_id, from);
+                    sqlite3_finalize(select);
+                    sqlite3_close(db);
+                }
+                ++done;
+            }
+            queries.fetch_add(done, std::memory_order_relaxed);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    stop.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    writer.join();
+
+    Result result;
+    result.queries_per_second = static_cast<double>(queries.load()) / options.seconds;
+    if (!commit_ms.empty()) {
+        std::sort(commit_ms.begin(), commit_ms.end());
+        result.commit_p50_ms = commit_ms[commit_ms.size() / 2];
+        result.commit_p99_ms = commit_ms[commit_ms.size() * 99 / 100];
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <db_path> [seconds_per_run=3] [max_readers=8] [devices=200] [readings_per_device=2000] [commit_rows=512]"
+                  << std::endl;
+        return 1;
+    }
+    Options options;
+    options.path = argv[1];
+    if (argc > 2) options.seconds = std::max(1, std::atoi(argv[2]));
+    if (argc > 3) options.max_readers = std::max(1ul, std::strtoul(argv[3], nullptr, 10));
+    if (argc > 4) options.devices = std::max(1ul, std::strtoul(argv[4], nullptr, 10));
+    if (argc > 5) options.per_device = std::max(1ul, std::strtoul(argv[5], nullptr, 10));
+    if (argc > 6) options.commit_rows = std::max(1ul, std::strtoul(argv[6], nullptr, 10));
+
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::remove((options.path + suffix).c_str());
+    }
+    std::size_t next_index = 0;
+    {
+        SqliteConnection db(options.path);
+        db.open();
+        db.configure(StorageSettings::for_profile(StorageProfile::Durable));
+        db.exec("CREATE TABLE sensor_data (id INTEGER PRIMARY KEY AUTOINCREMENT, device_id TEXT, light_intensity REAL, "
+                "temperature REAL, air_humidity REAL, soil_humidity REAL, prediction TEXT, timestamp INTEGER, note TEXT);"
+                "CREATE INDEX sensor_data_device_time ON sensor_data (device_id, timestamp);");
+        db.exec("BEGIN;");
+        insert_rows(db, options.devices, 0, options.devices * options.per_device);
+        db.exec("COMMIT;");
+        next_index = options.devices * options.per_device;
+    }
+
+    SqliteReadPool pool(options.path, options.max_readers);
+    pool.open(StorageSettings::for_profile(StorageProfile::Durable).mmap_size);
+
+    std::cout << "rows: " << next_index << " (" << options.devices << " devices), " << options.seconds
+              << " s per run, writer commits " << options.commit_rows << " rows per transaction" << std::endl;
+    Result idle = run(options, pool, 0, true, next_index);
+    std::cout << "no readers:     commit p50=" << idle.commit_p50_ms << " ms p99=" << idle.commit_p99_ms << " ms" << std::endl;
+    for (std::size_t readers = 1; readers <= options.max_readers; readers *= 2) {
+        for (bool pooled : {false, true}) {
+            Result result = run(options, pool, readers, pooled, next_index);
+            std::cout << (pooled ? "pool      " : "per-query ") << readers << " readers: " << result.queries_per_second
+                      << " queries/s, commit p50=" << result.commit_p50_ms << " ms p99=" << result.commit_p99_ms << " ms"
+                      << std::endl;
+        }
+    }
+    std::cout << "pool waits: " << pool.waits() << std::endl;
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Mô phỏng "cơn bão kết nối lại" sau khi mất điện: hàng trăm/hàng nghìn gateway cùng kết nối vào
+// LoRaServer trong cùng một khoảnh khắc, mỗi gateway gửi một bản ghi rồi chờ máy chủ đóng kết nối.
+// Mỗi vòng in ra thời gian để toàn bộ gateway được phục vụ và độ trễ connect/hoàn tất p50/p99.
+//
+// Cách dùng: reconnect_storm_bench <host> <port> [gateways=1000] [rounds=5] [client_threads=4]
+//
+// So sánh máy chủ chạy một acceptor với chế độ --acceptor-shards=N trên cùng máy.
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+// Trạng thái của một gateway giả lập trong một vòng.
+struct Gateway : std::enable_shared_from_this<Gateway> {
+    Gateway(boost::asio::io_context& io, std::string record, bench_clock::time_point storm_start)
+            : socket(io), record(std::move(record)), storm_start(storm_start) {}
+
+    tcp::socket socket;
+    std::string record;
+    bench_clock::time_point storm_start;
+    std::array<char, 64> sink{};
+    double connect_us = -1; // Thời gian từ lúc bắt đầu cơn bão đến lúc connect xong.
+    double done_us = -1; // Thời gian đến lúc máy chủ đóng kết nối.
+
+    void run(const tcp::endpoint& endpoint) {
+        auto self = shared_from_this();
+        socket.async_connect(endpoint, [this, self](const boost::system::error_code& error) {
+            if (error) {
+                return;
+            }
+            connect_us = elapsed_us();
+            boost::asio::async_write(socket, boost::asio::buffer(record),
+                                     [this, self](const boost::system::error_code& error, size_t) {
+                                         if (error) {
+                                             return;
+                                         }
+                                         boost::system::error_code ignored;
+                                         socket.shutdown(tcp::socket::shutdown_send, ignored);
+                                         wait_for_close();
+                                     });
+        });
+    }
+
+    void wait_for_close() {
+        auto self = shared_from_this();
+        socket.async_read_some(boost::asio::buffer(sink), [this, self](const boost::system::error_code& error, size_t) {
+            if (!error) {
+                wait_for_close();
+                return;
+            }
+            if (error == boost::asio::error::eof) {
+                done_us = elapsed_us();
+            }
+        });
+    }
+
+    double elapsed_us() const {
+        return std::chrono::duration<double, std::micro>(bench_clock::now() - storm_start).count();
+    }
+};
+
+double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * static_cast<double>(values.size() - 1))];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <host> <port> [gateways=1000] [rounds=5] [client_threads=4]" << std::endl;
+        return 1;
+    }
+
+    const std::string host = argv[1];
+    const std::string port = argv[2];
+    const int gateways = argc > 3 ? std::atoi(argv[3]) : 1000;
+    const int rounds = argc > 4 ? std::atoi(argv[4]) : 5;
+    const int client_threads = argc > 5 ? std::max(1, std::atoi(argv[5])) : 4;
+
+    boost::asio::io_context resolve_io;
+    const tcp::endpoint endpoint = *tcp::resolver(resolve_io).resolve(host, port).begin();
+
+    for (int round = 0; round < rounds; ++round) {
+        // Mỗi luồng client có io_context riêng; mọi kết nối được khởi động cùng một thời điểm.
+        std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+        for (int t = 0; t < client_threads; ++t) {
+            contexts.push_back(std::make_unique<boost::asio::io_context>());
+        }
+
+        const auto storm_start = bench_clock::now();
+        std::vector<std::shared_ptr<Gateway>> storm;
+        storm.reserve(gateways);
+        for (int g = 0; g < gateways; ++g) {
+            auto& io = *contexts[g % client_threads];
+            storm.push_back(std::make_shared<Gateway>(io, "storm-" + std::to_string(g) + ":1700 25 60 65\n", storm_start));
+            storm.back()->run(endpoint);
+        }
+
+        std::vector<std::thread> threads;
+        for (auto& io : contexts) {
+            threads.emplace_back([&io]() { io->run(); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        std::vector<double> connect_us;
+        std::vector<double> done_us;
+        for (const auto& gateway : storm) {
+            if (gateway->connect_us >= 0) {
+                connect_us.push_back(gateway->connect_us);
+            }
+            if (gateway->done_us >= 0) {
+                done_us.push_back(gateway->done_us);
+            }
+        }
+
+        double storm_ms = done_us.empty() ? 0 : *std::max_element(done_us.begin(), done_us.end()) / 1000.0;
+        std::cout << "round " << round + 1 << ": served " << done_us.size() << "/" << gateways
+                  << " in " << storm_ms << " ms"
+                  << " | connect p50 " << percentile(connect_us, 0.50) / 1000.0 << " ms"
+                  << " p99 " << percentile(connect_us, 0.99) / 1000.0 << " ms"
+                  << " | done p50 " << percentile(done_us, 0.50) / 1000.0 << " ms"
+                  << " p99 " << percentile(done_us, 0.99) / 1000.0 << " ms" << std::endl;
+    }
+    return 0;
+}
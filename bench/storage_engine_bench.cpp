@@ -0,0 +1,212 @@
+// So sánh ColumnarStore với bảng sensor_data của SQLite trên cùng một ổ đĩa: tốc độ ghi theo group commit,
+// số byte trên đĩa cho mỗi bản ghi và độ trễ truy vấn một khoảng thời gian của một thiết bị.
+// SQLite dùng schema, chỉ mục (device_id, timestamp) và hồ sơ durable (WAL, synchronous=FULL) như máy chủ;
+// cả hai bên fsync một lần cho mỗi group commit.
+//
+// Cách dùng: storage_engine_bench <dir> [devices=200] [readings_per_device=5000] [rows_per_commit=512] [queries=2000]
+// Bản ghi của mỗi thiết bị cách nhau 10 giây; mỗi truy vấn lấy 1 giờ (360 bản ghi) của một thiết bị ngẫu nhiên.
+
+#include <sqlite3.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "columnar_store.h"
+#include "sqlite_connection.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::int64_t kStartMs = 1704067200000; // 2024-01-01 00:00:00 UTC.
+constexpr std::int64_t kIntervalMs = 10000;
+constexpr std::int64_t kQueryWindowMs = 60 * 60 * 1000;
+
+struct Reading {
+    std::string device_id;
+    std::int64_t timestamp_ms;
+    double values[4];
+};
+
+// Giá trị thay đổi chậm quanh mức thường thấy trong log.txt (1700/25/60/65), làm tròn tới 0.1 như độ phân giải
+// của cảm biến.
+Reading make_reading(std::size_t device, std::size_t index, std::mt19937& rng) {
+    std::normal_distribution<double> noise(0.0, 0.05);
+    double phase = static_cast<double>(index) / 360.0;
+    auto sensor = [](double value) { return std::round(value * 10) / 10; };
+    return {"device-" + std::to_string(device), kStartMs + static_cast<std::int64_t>(index) * kIntervalMs,
+            {sensor(1700 + 50 * std::sin(phase)), sensor(25 + 2 * std::sin(phase) + noise(rng)), sensor(60 + noise(rng)),
+             sensor(65 + noise(rng))}};
+}
+
+std::uint64_t directory_bytes(const std::filesystem::path& path) {
+    std::uint64_t total = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+        if (entry.is_regular_file()) {
+            total += entry.file_size();
+        }
+    }
+    return total;
+}
+
+struct Result {
+    double rows_per_second = 0;
+    double bytes_per_reading = 0;
+    double query_us = 0;
+    std::size_t rows_returned = 0;
+};
+
+Result run_sqlite(const std::filesystem::path& dir, const std::vector<Reading>& readings, std::size_t rows_per_commit,
+                  const std::vector<std::pair<std::string, std::int64_t>>& queries) {
+    std::filesystem::create_directories(dir);
+    SqliteConnection db((dir / "lora.db").string());
+    db.open();
+    db.configure(StorageSettings::for_profile(StorageProfile::Durable));
+    db.exec("CREATE TABLE sensor_data (id INTEGER PRIMARY KEY AUTOINCREMENT, device_id TEXT, light_intensity REAL, "
+            "temperature REAL, air_humidity REAL, soil_humidity REAL, prediction TEXT, timestamp INTEGER, note TEXT);"
+            "CREATE INDEX sensor_data_device_time ON sensor_data (device_id, timestamp);");
+
+    Result result;
+    auto begin = bench_clock::now();
+    {
+        Statement insert(db, "INSERT INTO sensor_data (device_id, light_intensity, temperature, air_humidity, soil_humidity, "
+                             "timestamp, prediction, note) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+        for (std::size_t i = 0; i < readings.size(); i += rows_per_commit) {
+            db.exec("BEGIN;");
+            for (std::size_t j = i; j < std::min(readings.size(), i + rows_per_commit); ++j) {
+                const Reading& r = readings[j];
+                sqlite3_bind_text(insert.get(), 1, r.device_id.c_str(), -1, SQLITE_STATIC);
+                for (int c = 0; c < 4; ++c) {
+                    sqlite3_bind_double(insert.get(), 2 + c, r.values[c]);
+                }
+                sqlite3_bind_int64(insert.get(), 6, r.timestamp_ms);
+                sqlite3_bind_text(insert.get(), 7, "good", -1, SQLITE_STATIC);
+                sqlite3_bind_text(insert.get(), 8, "", -1, SQLITE_STATIC);
+                sqlite3_step(insert.get());
+                insert.reset();
+            }
+            db.exec("COMMIT;");
+        }
+    }
+    result.rows_per_second = static_cast<double>(readings.size()) / std::chrono::duration<double>(bench_clock::now() - begin).count();
+
+    db.exec("PRAGMA wal_checkpoint(TRUNCATE);");
+    result.bytes_per_reading = static_cast<double>(directory_bytes(dir)) / static_cast<double>(readings.size());
+
+    Statement select(db, "SELECT timestamp, light_intensity, temperature, air_humidity, soil_humidity FROM sensor_data "
+                         "WHERE device_id = ? AND timestamp BETWEEN ? AND ?");
+    double checksum = 0;
+    begin = bench_clock::now();
+    for (const auto& [device_id, from] : queries) {
+        sqlite3_bind_text(select.get(), 1, device_id.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(select.get(), 2, from);
+        sqlite3_bind_int64(select.get(), 3, from + kQueryWindowMs - 1);
+        while (sqlite3_step(select.get()) == SQLITE_ROW) {
+            checksum += sqlite3_column_double(select.get(), 2);
+            ++result.rows_returned;
+        }
+        select.reset();
+    }
+    result.query_us = std::chrono::duration<double, std::micro>(bench_clock::now() - begin).count() /
+                      static_cast<double>(queries.size());
+    return checksum < 0 ? Result{} : result;
+}
+
+Result run_columnar(const std::filesystem::path& dir, const std::vector<Reading>& readings, std::size_t rows_per_commit,
+                    const std::vector<std::pair<std::string, std::int64_t>>& queries) {
+    ColumnarStore store(dir.string());
+    store.open();
+
+    Result result;
+    auto begin = bench_clock::now();
+    for (std::size_t i = 0; i < readings.size(); i += rows_per_commit) {
+        for (std::size_t j = i; j < std::min(readings.size(), i + rows_per_commit); ++j) {
+            const Reading& r = readings[j];
+            ColumnarStore::Row row;
+            row.timestamp_ms = r.timestamp_ms;
+            for (int c = 0; c < 4; ++c) {
+                row.values[c] = static_cast<float>(r.values[c]);
+            }
+            row.prediction = 1;
+            store.append(r.device_id, row);
+        }
+        store.commit();
+    }
+    store.checkpoint(); // Dồn phần còn trong WAL để đo dung lượng và truy vấn trên khối đã đóng.
+    result.rows_per_second = static_cast<double>(readings.size()) / std::chrono::duration<double>(bench_clock::now() - begin).count();
+    result.bytes_per_reading = static_cast<double>(directory_bytes(dir)) / static_cast<double>(readings.size());
+    std::cout << "columnar blocks: " << store.block_bytes() << " bytes, compression "
+              << static_cast<double>(store.raw_block_bytes()) / static_cast<double>(store.block_bytes())
+              << "x vs raw columns" << std::endl;
+
+    double checksum = 0;
+    begin = bench_clock::now();
+    for (const auto& [device_id, from] : queries) {
+        store.scan(device_id, from, from + kQueryWindowMs - 1, [&](const ColumnarStore::Row& row) {
+            checksum += row.values[1];
+            ++result.rows_returned;
+        });
+    }
+    result.query_us = std::chrono::duration<double, std::micro>(bench_clock::now() - begin).count() /
+                      static_cast<double>(queries.size());
+    return checksum < 0 ? Result{} : result;
+}
+
+void print(const char* name, const Result& r) {
+    std::cout << name << " ingest=" << r.rows_per_second << " rows/s, disk=" << r.bytes_per_reading
+              << " bytes/reading, 1h range scan=" << r.query_us << " us (" << r.rows_returned << " rows)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <dir> [devices=200] [readings_per_device=5000] [rows_per_commit=512] [queries=2000]" << std::endl;
+        return 1;
+    }
+    const std::filesystem::path dir = argv[1];
+    const std::size_t devices = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    const std::size_t per_device = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 5000;
+    const std::size_t rows_per_commit = argc > 4 ? std::max(1ul, std::strtoul(argv[4], nullptr, 10)) : 512;
+    const std::size_t query_count = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 2000;
+
+    // Thứ tự đến như ở máy chủ: mỗi chu kỳ 10 giây, mọi thiết bị gửi một bản ghi.
+    std::mt19937 rng(42);
+    std::vector<Reading> readings;
+    readings.reserve(devices * per_device);
+    for (std::size_t i = 0; i < per_device; ++i) {
+        for (std::size_t d = 0; d < devices; ++d) {
+            readings.push_back(make_reading(d, i, rng));
+        }
+    }
+
+    std::vector<std::pair<std::string, std::int64_t>> queries;
+    std::uniform_int_distribution<std::size_t> pick_device(0, devices - 1);
+    std::uniform_int_distribution<std::int64_t> pick_start(kStartMs, kStartMs + static_cast<std::int64_t>(per_device) * kIntervalMs - kQueryWindowMs);
+    for (std::size_t i = 0; i < query_count; ++i) {
+        queries.emplace_back("device-" + std::to_string(pick_device(rng)), pick_start(rng));
+    }
+
+    std::filesystem::remove_all(dir);
+    std::cout << "readings: " << readings.size() << " (" << devices << " devices x " << per_device << "), rows/commit="
+              << rows_per_commit << ", queries=" << queries.size() << std::endl;
+
+    Result sqlite = run_sqlite(dir / "sqlite", readings, rows_per_commit, queries);
+    print("sqlite:  ", sqlite);
+    Result columnar = run_columnar(dir / "columnar", readings, rows_per_commit, queries);
+    print("columnar:", columnar);
+
+    std::cout << "columnar vs sqlite: ingest " << columnar.rows_per_second / sqlite.rows_per_second << "x, disk "
+              << sqlite.bytes_per_reading / columnar.bytes_per_reading << "x smaller, range scan "
+              << sqlite.query_us / columnar.query_us << "x faster" << std::endl;
+    return 0;
+}
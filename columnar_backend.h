@@ -0,0 +1,163 @@
+#ifndef DATABASE_SERVER_COLUMNAR_BACKEND_H
+#define DATABASE_SERVER_COLUMNAR_BACKEND_H
+
+// Bản ghi cảm biến trong ColumnarStore (--storage-engine=columnar). Chỉ có trên POSIX, như ColumnarStore.
+#ifndef _WIN32
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "columnar_store.h"
+#include "storage_backend.h"
+
+// Bảng tổng hợp, thời hạn lưu giữ và --change-only chỉ áp dụng cho SQLite: khối nén của kho dạng cột đã
+// chỉ tốn khoảng một bit cho mỗi giá trị lặp lại.
+//
+// Với background_checkpoints (--checkpoint-interval khác 0, như SqliteBackend), checkpoint của kho chạy trên
+// luồng nền khi WAL đủ lớn: luồng ghi chỉ chờ hai pha ngắn giữ mutex_ chứ không chờ việc mã hóa và fsync
+// segment của mọi thiết bị. Nếu không, commit() tự checkpoint trên luồng ghi và lô đó chịu cả khoảng dừng.
+class ColumnarBackend : public StorageBackend {
+public:
+    ColumnarBackend(std::string directory, bool background_checkpoints)
+        : store_(std::move(directory)), background_checkpoints_(background_checkpoints) {
+        store_.set_auto_checkpoint(!background_checkpoints);
+    }
+
+    const char* name() const override { return "columnar"; }
+
+    bool open() override {
+        if (!store_.open()) {
+            return false;
+        }
+        std::cout << "Storage engine: columnar (" << store_.directory() << ", " << store_.devices() << " devices, "
+                  << store_.rows() << " readings in " << store_.blocks() << " blocks, "
+                  << (background_checkpoints_ ? "background" : "inline") << " checkpoints); rollups, retention and "
+                  << "change-only apply to SQLite only" << std::endl;
+        return true;
+    }
+
+    void start_background(std::vector<std::thread>& workers) override {
+        if (background_checkpoints_) {
+            workers.emplace_back([this]() { run_checkpointer(); });
+        }
+    }
+
+    // Ghi cả lô vào kho dạng cột với một lần fsync WAL.
+    std::size_t insert_batch(std::vector<DeviceReading>& batch, const Annotate& annotate, std::vector<bool>* stored_rows,
+                             std::vector<bool>* repeated_rows) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stored_rows != nullptr) {
+            stored_rows->assign(batch.size(), false);
+        }
+        if (repeated_rows != nullptr) {
+            repeated_rows->assign(batch.size(), false);
+        }
+        for (DeviceReading& reading : batch) {
+            SensorData& sensor_data = reading.sensor_data;
+            annotate(sensor_data);
+            ColumnarStore::Row row;
+            row.timestamp_ms = sensor_data.timestamp_ms;
+            row.values[0] = static_cast<float>(sensor_data.light_intensity);
+            row.values[1] = static_cast<float>(sensor_data.temperature);
+            row.values[2] = static_cast<float>(sensor_data.air_humidity);
+            row.values[3] = static_cast<float>(sensor_data.soil_humidity);
+            row.prediction = prediction_code(sensor_data.prediction);
+            store_.append(reading.device_id, row);
+        }
+        if (!store_.commit()) {
+            return 0;
+        }
+        if (background_checkpoints_ && store_.checkpoint_due()) {
+            checkpoint_wanted_.notify_one();
+        }
+        if (stored_rows != nullptr) {
+            stored_rows->assign(batch.size(), true);
+        }
+        return batch.size();
+    }
+
+    // Chỉ đọc cột nhãn và cột nhiệt độ của mỗi khối.
+    void scan_training(const std::function<void(double)>& fn) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        store_.scan_labelled(1, [&fn](float temperature) { fn(temperature); });
+    }
+
+    // Ghi chú không được lưu trong kho dạng cột.
+    bool query_range(const std::string& device_id, std::int64_t from_ms, std::int64_t to_ms, std::size_t limit,
+                     const std::function<void(const SensorData&)>& fn) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SensorData data;
+        std::size_t rows = 0;
+        store_.scan(device_id, from_ms, to_ms, [&](const ColumnarStore::Row& row) {
+            if (rows == limit) {
+                return;
+            }
+            ++rows;
+            data.light_intensity = row.values[0];
+            data.temperature = row.values[1];
+            data.air_humidity = row.values[2];
+            data.soil_humidity = row.values[3];
+            data.timestamp_ms = row.timestamp_ms;
+            data.prediction = prediction_label(row.prediction);
+            fn(data);
+        });
+        return true;
+    }
+
+    void report_metrics(std::ostream& out) const override {
+        std::uint64_t bytes = store_.disk_bytes();
+        std::uint64_t rows = store_.rows();
+        out << "[metrics] columnar devices=" << store_.devices() << " rows=" << rows << " blocks=" << store_.blocks()
+            << " checkpoints=" << store_.checkpoints() << " disk_bytes=" << bytes << " bytes_per_reading="
+            << (rows == 0 ? 0.0 : static_cast<double>(bytes) / static_cast<double>(rows));
+        std::uint64_t raw_block_bytes = store_.raw_block_bytes();
+        std::uint64_t block_bytes = store_.block_bytes();
+        out << " block_bytes=" << block_bytes << " compression="
+            << (block_bytes == 0 ? 0.0 : static_cast<double>(raw_block_bytes) / static_cast<double>(block_bytes))
+            << " last_checkpoint_ms=" << static_cast<double>(store_.last_checkpoint_us()) / 1000.0
+            << " last_checkpoint_lock_ms=" << static_cast<double>(store_.last_checkpoint_lock_us()) / 1000.0 << "\n";
+    }
+
+private:
+    // Luồng nền: chờ WAL đủ lớn rồi checkpoint; chỉ pha đầu và pha cuối giữ mutex_.
+    void run_checkpointer() {
+        for (;;) {
+            ColumnarStore::CheckpointPlan plan;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                checkpoint_wanted_.wait(lock, [this] { return store_.checkpoint_due(); });
+                plan = store_.begin_checkpoint();
+            }
+            bool ok = store_.write_checkpoint(plan);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!ok) {
+                    store_.abort_checkpoint(plan);
+                } else {
+                    ok = store_.finish_checkpoint(plan);
+                }
+            }
+            if (!ok) {
+                // Dữ liệu vẫn an toàn trong WAL; nghỉ rồi thử lại thay vì lặp liên tục khi đĩa lỗi.
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+        }
+    }
+
+    ColumnarStore store_;
+    const bool background_checkpoints_;
+    std::mutex mutex_; // Bảo vệ store_ giữa luồng ghi, luồng checkpoint và các luồng truy vấn.
+    std::condition_variable checkpoint_wanted_; // Luồng ghi báo WAL đã đủ lớn.
+};
+
+#endif // _WIN32
+
+#endif //DATABASE_SERVER_COLUMNAR_BACKEND_H
@@ -0,0 +1,876 @@
+#ifndef DATABASE_SERVER_COLUMNAR_STORE_H
+#define DATABASE_SERVER_COLUMNAR_STORE_H
+
+// Kho chuỗi thời gian dạng cột, chỉ ghi nối tiếp, dùng thay cho bảng sensor_data khi chạy với
+// --storage-engine=columnar. Cần mmap/pwrite/fsync nên chỉ có trên các hệ POSIX.
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gorilla_codec.h"
+
+// Mỗi thiết bị có một tệp segment gồm các khối; mỗi khối giữ tối đa kBlockCapacity bản ghi theo từng cột
+// (dấu thời gian, bốn giá trị float, nhãn dự đoán) sau một header có khoảng thời gian của khối, nên truy vấn
+// theo khoảng thời gian bỏ qua được cả khối mà không đọc dữ liệu. Segment được đọc qua mmap. Khối mới được nén
+// kiểu Gorilla (gorilla_codec.h), mỗi cột một luồng bit; khối dạng thô của các phiên bản trước vẫn đọc được.
+//
+// Độ bền: mỗi commit() nối các bản ghi mới vào wal.log và fsync một lần, bất kể có bao nhiêu thiết bị.
+// Bản ghi chưa nằm trong khối được giữ trong bộ nhớ; checkpoint() dồn chúng thành khối, fsync các segment
+// rồi mới thay wal.log bằng WAL thế hệ mới. Khối mang số thế hệ của WAL chứa các bản ghi của nó, nên khi mở
+// lại, khối có thế hệ >= thế hệ của wal.log (checkpoint bị ngắt giữa chừng) được cắt bỏ và WAL được phát lại.
+//
+// checkpoint() gồm ba pha để chạy được trên luồng nền (xem ColumnarBackend): begin_checkpoint() tách các bản
+// ghi trong bộ nhớ ra, write_checkpoint() mã hóa, ghi và fsync segment mà không đụng tới trạng thái dùng
+// chung, finish_checkpoint() thay WAL và cập nhật chỉ mục khối. Trong lúc ghi, commit() vẫn nối vào WAL cũ;
+// WAL mới chỉ chứa lại các bản ghi đó nên pha cuối nhanh dù segment lớn.
+//
+// Không an toàn cho nhiều luồng: nơi gọi tự khóa, trừ write_checkpoint() chạy được song song với mọi hàm
+// khác ngoài begin/finish/abort_checkpoint(). Các hàm thống kê (rows, blocks, disk_bytes...) đọc được từ
+// luồng in số liệu.
+class ColumnarStore {
+public:
+    static constexpr int kValueCount = 4; // light, temperature, air humidity, soil humidity.
+    static constexpr std::size_t kBlockCapacity = 1024; // Số bản ghi tối đa trong một khối.
+    static constexpr std::uint64_t kCheckpointWalBytes = 16u << 20; // WAL lớn hơn thì cần checkpoint.
+
+    struct Row {
+        std::int64_t timestamp_ms = 0;
+        float values[kValueCount]{};
+        std::uint8_t prediction = 0; // 0 = chưa gán nhãn; các giá trị khác do nơi gọi quy ước.
+    };
+
+    explicit ColumnarStore(std::string directory) : directory_(std::move(directory)) {}
+
+    ~ColumnarStore() {
+        close();
+    }
+
+    ColumnarStore(const ColumnarStore&) = delete;
+    ColumnarStore& operator=(const ColumnarStore&) = delete;
+
+    // Mở (hoặc tạo) thư mục dữ liệu: nạp header các khối, cắt phần dở dang và phát lại WAL.
+    bool open() {
+        if (wal_fd_ >= 0) {
+            return true;
+        }
+        if (::mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+            return fail("cannot create " + directory_);
+        }
+
+        std::vector<char> wal;
+        bool have_wal = read_file(wal_path(), wal);
+        if (have_wal) {
+            WalHeader header{};
+            if (wal.size() >= sizeof(header)) {
+                std::memcpy(&header, wal.data(), sizeof(header));
+            }
+            if (header.magic != kWalMagic) {
+                errno = EINVAL;
+                return fail(wal_path() + " is not a columnar WAL");
+            }
+            generation_ = header.generation;
+        }
+
+        if (!load_segments(have_wal)) {
+            return false;
+        }
+        if (!have_wal) {
+            generation_ = max_generation_ + 1;
+            if (!write_new_wal()) {
+                return false;
+            }
+            wal_bytes_ = sizeof(WalHeader);
+        } else {
+            // Cắt đuôi ghi dở để bản ghi mới không nằm sau phần rác mà lần phát lại sau sẽ dừng ở đó.
+            wal_bytes_ = replay_wal(wal);
+            if (wal_bytes_ != wal.size()) {
+                truncate_file(wal_path(), wal_bytes_);
+            }
+        }
+
+        wal_fd_ = ::open(wal_path().c_str(), O_WRONLY | O_APPEND);
+        if (wal_fd_ < 0) {
+            return fail("cannot open " + wal_path());
+        }
+        return true;
+    }
+
+    void close() {
+        for (auto& [device_id, series] : series_) {
+            series.unmap();
+        }
+        series_.clear();
+        if (wal_fd_ >= 0) {
+            ::close(wal_fd_);
+            wal_fd_ = -1;
+        }
+    }
+
+    bool is_open() const { return wal_fd_ >= 0; }
+    const std::string& directory() const { return directory_; }
+
+    // Thêm một bản ghi vào giao dịch đang gom; chỉ thấy được và bền sau commit().
+    void append(std::string_view device_id, const Row& row) {
+        pending_.push_back({std::string(device_id), row});
+        append_wal_record(device_id, row);
+    }
+
+    // Ghi các bản ghi đang gom vào WAL với một lần fsync. Trả về false (và bỏ chúng) nếu ghi thất bại.
+    bool commit() {
+        if (pending_.empty()) {
+            return true;
+        }
+        bool ok = write_all(wal_fd_, wal_buffer_.data(), wal_buffer_.size()) && sync(wal_fd_);
+        if (!ok) {
+            std::cerr << "Columnar WAL write error: " << std::strerror(errno) << std::endl;
+            // Cắt phần có thể đã ghi được để lần phát lại sau không thấy bản ghi chưa commit.
+            if (::ftruncate(wal_fd_, static_cast<off_t>(wal_bytes_.load())) != 0) {
+                std::cerr << "Columnar WAL truncate error: " << std::strerror(errno) << std::endl;
+            }
+            rollback();
+            return false;
+        }
+
+        wal_bytes_ += wal_buffer_.size();
+        for (PendingRow& pending : pending_) {
+            series_[pending.device_id].open.push_back(pending.row);
+        }
+        rows_ += pending_.size();
+        devices_ = series_.size();
+        pending_.clear();
+        wal_buffer_.clear();
+
+        if (auto_checkpoint_ && checkpoint_due()) {
+            checkpoint(); // Thất bại thì dữ liệu vẫn an toàn trong WAL; thử lại ở lần commit sau.
+        }
+        return true;
+    }
+
+    // Tắt để commit() không tự checkpoint trên luồng gọi; khi đó nơi gọi chạy checkpoint khi checkpoint_due().
+    void set_auto_checkpoint(bool enabled) { auto_checkpoint_ = enabled; }
+    bool checkpoint_due() const { return wal_bytes_ >= kCheckpointWalBytes; }
+
+    void rollback() {
+        pending_.clear();
+        wal_buffer_.clear();
+    }
+
+    struct CheckpointPlan; // Một checkpoint đang chạy, định nghĩa bên dưới.
+
+    // Dồn mọi bản ghi đang nằm trong bộ nhớ thành khối trong segment của từng thiết bị rồi bắt đầu WAL mới.
+    bool checkpoint() {
+        CheckpointPlan plan = begin_checkpoint();
+        if (!write_checkpoint(plan)) {
+            abort_checkpoint(plan);
+            return false;
+        }
+        return finish_checkpoint(plan);
+    }
+
+    // Pha 1 (giữ khóa): chuyển các bản ghi trong bộ nhớ sang sealing. Chúng vẫn đọc được qua scan().
+    CheckpointPlan begin_checkpoint() {
+        CheckpointPlan plan;
+        plan.started = std::chrono::steady_clock::now();
+        plan.generation = generation_;
+        for (auto& [device_id, series] : series_) {
+            if (series.open.empty()) {
+                continue;
+            }
+            series.sealing = std::move(series.open);
+            series.open.clear();
+            std::string path = series.path;
+            if (path.empty()) {
+                path = directory_ + "/" + std::to_string(next_segment_id_++) + ".seg";
+                plan.created_files = true;
+            }
+            plan.items.push_back({device_id, &series, std::move(path), series.file_size, 0, {}});
+        }
+        return plan;
+    }
+
+    // Pha 2 (không cần khóa): mã hóa sealing thành khối, nối vào segment và fsync. Chỉ đọc sealing và các
+    // trường của plan; nếu thất bại, các tệp đã được trả về như cũ và nơi gọi phải gọi abort_checkpoint().
+    bool write_checkpoint(CheckpointPlan& plan) {
+        for (std::size_t n = 0; n < plan.items.size(); ++n) {
+            CheckpointPlan::Item& item = plan.items[n];
+            const std::vector<Row>& rows = item.series->sealing;
+            std::vector<char> bytes;
+            if (item.old_size == 0) {
+                append_segment_header(item.device_id, bytes);
+            }
+            for (std::size_t begin = 0; begin < rows.size(); begin += kBlockCapacity) {
+                std::size_t count = std::min(kBlockCapacity, rows.size() - begin);
+                item.blocks.push_back(encode_block(&rows[begin], count, item.old_size + bytes.size(), plan.generation,
+                                                   plan.scratch, bytes));
+            }
+
+            int fd = ::open(item.path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            bool ok = fd >= 0 && write_all(fd, bytes.data(), bytes.size()) && sync(fd);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            if (!ok) {
+                std::cerr << "Columnar checkpoint error on " << item.path << ": " << std::strerror(errno) << std::endl;
+                for (std::size_t done = 0; done <= n; ++done) {
+                    undo_segment(plan.items[done]);
+                }
+                return false;
+            }
+            item.new_size = item.old_size + bytes.size();
+        }
+        if (plan.created_files) {
+            sync_directory();
+        }
+        return true;
+    }
+
+    // Pha 3 (giữ khóa): ghi WAL thế hệ mới chỉ gồm các bản ghi commit sau begin_checkpoint(), rồi đưa các khối
+    // vừa ghi vào chỉ mục. Thời gian giữ khóa tỉ lệ với số bản ghi đó, không với số thiết bị hay khối.
+    bool finish_checkpoint(CheckpointPlan& plan) {
+        const auto locked = std::chrono::steady_clock::now();
+        std::vector<char> records;
+        for (const auto& [device_id, series] : series_) {
+            for (const Row& row : series.open) {
+                append_wal_record(records, device_id, row);
+            }
+        }
+        ++generation_;
+        if (!write_new_wal(records)) {
+            --generation_; // WAL cũ vẫn còn nguyên nên các khối vừa ghi là thừa.
+            for (CheckpointPlan::Item& item : plan.items) {
+                undo_segment(item);
+            }
+            abort_checkpoint(plan);
+            return false;
+        }
+        ::close(wal_fd_);
+        wal_fd_ = ::open(wal_path().c_str(), O_WRONLY | O_APPEND);
+        wal_bytes_ = sizeof(WalHeader) + records.size();
+
+        for (CheckpointPlan::Item& item : plan.items) {
+            Series& series = *item.series;
+            series.path = item.path;
+            series.file_size = item.new_size;
+            segment_bytes_ += item.new_size - item.old_size;
+            series.blocks.insert(series.blocks.end(), item.blocks.begin(), item.blocks.end());
+            blocks_ += item.blocks.size();
+            for (const BlockRef& block : item.blocks) {
+                raw_block_bytes_ += payload_size(block.count);
+                block_bytes_ += block.payload_bytes;
+            }
+            series.sealing.clear();
+            series.remap();
+        }
+        ++checkpoints_;
+        const auto done = std::chrono::steady_clock::now();
+        last_checkpoint_us_ = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(done - plan.started).count());
+        last_checkpoint_lock_us_ = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(done - locked).count());
+        return wal_fd_ >= 0;
+    }
+
+    // Bỏ checkpoint (giữ khóa): trả sealing về trước các bản ghi commit sau đó, dữ liệu vẫn nằm trong WAL.
+    void abort_checkpoint(CheckpointPlan& plan) {
+        for (CheckpointPlan::Item& item : plan.items) {
+            Series& series = *item.series;
+            series.sealing.insert(series.sealing.end(), series.open.begin(), series.open.end());
+            series.open = std::move(series.sealing);
+            series.sealing.clear();
+        }
+        plan.items.clear();
+    }
+
+    // Gọi fn(const Row&) cho mọi bản ghi đã commit của device_id có from_ms <= timestamp_ms <= to_ms,
+    // theo thứ tự ghi. Khối nằm ngoài khoảng được bỏ qua chỉ nhờ header.
+    template <typename Fn>
+    void scan(std::string_view device_id, std::int64_t from_ms, std::int64_t to_ms, Fn&& fn) const {
+        auto it = series_.find(std::string(device_id));
+        if (it == series_.end()) {
+            return;
+        }
+        const Series& series = it->second;
+        for (std::size_t b = 0; b < series.readable_blocks(); ++b) {
+            const BlockRef& block = series.blocks[b];
+            if (block.max_ts < from_ms || block.min_ts > to_ms) {
+                continue;
+            }
+            // Giải mã dấu thời gian trước; các cột còn lại chỉ tới bản ghi cuối cùng nằm trong khoảng.
+            const DecodedBlock& decoded = decode(series, block, kTimestampColumn, block.count);
+            std::uint32_t end = block.count;
+            while (end > 0 && (decoded.timestamps[end - 1] < from_ms || decoded.timestamps[end - 1] > to_ms)) {
+                --end;
+            }
+            decode(series, block, kAllColumns & ~kTimestampColumn, end);
+            Row row;
+            for (std::uint32_t i = 0; i < end; ++i) {
+                row.timestamp_ms = decoded.timestamps[i];
+                if (row.timestamp_ms < from_ms || row.timestamp_ms > to_ms) {
+                    continue;
+                }
+                for (int c = 0; c < kValueCount; ++c) {
+                    row.values[c] = decoded.values[c][i];
+                }
+                row.prediction = decoded.predictions[i];
+                fn(static_cast<const Row&>(row));
+            }
+        }
+        for (const std::vector<Row>* rows : {&series.sealing, &series.open}) {
+            for (const Row& row : *rows) {
+                if (row.timestamp_ms >= from_ms && row.timestamp_ms <= to_ms) {
+                    fn(row);
+                }
+            }
+        }
+    }
+
+    // Gọi fn(float) cho giá trị cột column của mọi bản ghi đã gán nhãn, trên mọi thiết bị.
+    // Chỉ giải mã hai cột cần thiết của mỗi khối.
+    template <typename Fn>
+    void scan_labelled(int column, Fn&& fn) const {
+        for (const auto& [device_id, series] : series_) {
+            for (std::size_t b = 0; b < series.readable_blocks(); ++b) {
+                const BlockRef& block = series.blocks[b];
+                const DecodedBlock& decoded = decode(series, block, kPredictionColumn | value_column(column), block.count);
+                for (std::uint32_t i = 0; i < block.count; ++i) {
+                    if (decoded.predictions[i] != 0) {
+                        fn(decoded.values[column][i]);
+                    }
+                }
+            }
+            for (const std::vector<Row>* rows : {&series.sealing, &series.open}) {
+                for (const Row& row : *rows) {
+                    if (row.prediction != 0) {
+                        fn(row.values[column]);
+                    }
+                }
+            }
+        }
+    }
+
+    std::uint64_t rows() const { return rows_; }
+    std::uint64_t blocks() const { return blocks_; }
+    std::uint64_t checkpoints() const { return checkpoints_; }
+    // Thời gian của checkpoint gần nhất: toàn bộ, và phần phải giữ khóa (finish_checkpoint()).
+    std::uint64_t last_checkpoint_us() const { return last_checkpoint_us_; }
+    std::uint64_t last_checkpoint_lock_us() const { return last_checkpoint_lock_us_; }
+    std::uint64_t devices() const { return devices_; }
+
+    // Tổng dung lượng trên đĩa: mọi segment cộng WAL hiện tại.
+    std::uint64_t disk_bytes() const { return segment_bytes_ + wal_bytes_; }
+
+    // Dữ liệu các cột trong khối: raw_block_bytes là kích thước nếu lưu thô, block_bytes là kích thước thực.
+    std::uint64_t raw_block_bytes() const { return raw_block_bytes_; }
+    std::uint64_t block_bytes() const { return block_bytes_; }
+
+private:
+    static constexpr std::uint32_t kWalMagic = 0x4C57414C; // "LAWL".
+    static constexpr std::uint32_t kSegmentMagic = 0x4C534547; // "GESL".
+    static constexpr std::uint32_t kBlockMagic = 0x4C424C4B; // "KLBL".
+    static constexpr std::uint16_t kEncodingRaw = 1; // Các cột lưu nguyên dạng nhị phân.
+    static constexpr std::uint16_t kEncodingGorilla = 2; // Mỗi cột một luồng bit nén, xem encode_block().
+    static constexpr int kColumnCount = kValueCount + 2; // Dấu thời gian, các giá trị, nhãn.
+
+    // Mặt nạ cột cần giải mã.
+    static constexpr unsigned kTimestampColumn = 1u;
+    static constexpr unsigned kPredictionColumn = 1u << (kValueCount + 1);
+    static constexpr unsigned kAllColumns = (1u << kColumnCount) - 1;
+    static constexpr unsigned value_column(int column) { return 1u << (column + 1); }
+
+    struct WalHeader {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t generation;
+    };
+
+    struct SegmentHeader {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t device_id_length; // Theo sau là ID thiết bị, đệm tới bội số của 8 byte.
+    };
+
+    // Header của một khối; theo sau là payload_bytes byte dữ liệu các cột.
+    struct BlockHeader {
+        std::uint32_t magic;
+        std::uint16_t encoding;
+        std::uint16_t reserved;
+        std::uint32_t count;
+        std::uint32_t payload_bytes;
+        std::uint64_t generation; // Thế hệ WAL chứa các bản ghi của khối.
+        std::int64_t min_ts;
+        std::int64_t max_ts;
+    };
+    static_assert(sizeof(BlockHeader) == 40);
+
+    // Chỉ mục khối trong bộ nhớ, dựng từ header khi mở.
+    struct BlockRef {
+        std::int64_t min_ts;
+        std::int64_t max_ts;
+        std::uint32_t count;
+        std::uint16_t encoding;
+        std::uint64_t offset; // Vị trí payload trong tệp segment.
+        std::uint32_t payload_bytes;
+    };
+
+    // Các cột của một khối sau khi giải mã; dùng lại giữa các khối để không cấp phát khi quét.
+    struct DecodedBlock {
+        std::vector<std::int64_t> timestamps;
+        std::vector<float> values[kValueCount];
+        std::vector<std::uint8_t> predictions;
+    };
+
+    // Đọc các cột của một khối thô thẳng từ vùng mmap. Cột: int64 dấu thời gian, 4 cột float, 1 cột u8 nhãn.
+    class BlockView {
+    public:
+        BlockView(const char* payload, std::uint32_t count) : payload_(payload), count_(count) {}
+
+        std::int64_t timestamp(std::uint32_t i) const { return load<std::int64_t>(payload_ + i * sizeof(std::int64_t)); }
+
+        float value(int column, std::uint32_t i) const {
+            return load<float>(payload_ + count_ * sizeof(std::int64_t) + (column * count_ + i) * sizeof(float));
+        }
+
+        std::uint8_t prediction(std::uint32_t i) const {
+            return static_cast<std::uint8_t>(payload_[count_ * (sizeof(std::int64_t) + kValueCount * sizeof(float)) + i]);
+        }
+
+    private:
+        template <typename T>
+        static T load(const char* p) {
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+
+        const char* payload_;
+        std::uint32_t count_;
+    };
+
+    struct Series {
+        std::string path; // Rỗng nếu chưa có segment trên đĩa.
+        std::uint64_t file_size = 0;
+        std::vector<BlockRef> blocks;
+        std::vector<Row> open; // Bản ghi đã commit (trong WAL) nhưng chưa nằm trong khối.
+        std::vector<Row> sealing; // Bản ghi đang được checkpoint ghi thành khối; cũ hơn mọi bản trong open.
+        const char* map = nullptr;
+        std::size_t mapped_size = 0;
+
+        // Ánh xạ lại toàn bộ tệp sau khi nó dài thêm. Nếu thất bại, các khối của thiết bị bị bỏ qua khi đọc.
+        void remap() {
+            unmap();
+            int fd = ::open(path.c_str(), O_RDONLY);
+            void* p = fd >= 0 ? ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (fd >= 0) {
+                ::close(fd); // Vùng ánh xạ vẫn hợp lệ sau khi đóng tệp; không giữ fd cho mỗi thiết bị.
+            }
+            if (p == MAP_FAILED) {
+                std::cerr << "Columnar store: cannot map " << path << ": " << std::strerror(errno) << std::endl;
+                return;
+            }
+            map = static_cast<const char*>(p);
+            mapped_size = file_size;
+        }
+
+        // Các khối đọc được qua vùng ánh xạ hiện tại.
+        std::size_t readable_blocks() const { return map != nullptr ? blocks.size() : 0; }
+
+        void unmap() {
+            if (map != nullptr) {
+                ::munmap(const_cast<char*>(map), mapped_size);
+                map = nullptr;
+                mapped_size = 0;
+            }
+        }
+    };
+
+    struct PendingRow {
+        std::string device_id;
+        Row row;
+    };
+
+public:
+    // Một checkpoint đang chạy: các bản ghi đã tách ra và segment sẽ ghi cho từng thiết bị.
+    struct CheckpointPlan {
+        struct Item {
+            std::string device_id;
+            Series* series;
+            std::string path; // Tệp segment (mới nếu thiết bị chưa có).
+            std::uint64_t old_size; // 0 = tệp được tạo trong checkpoint này.
+            std::uint64_t new_size = 0;
+            std::vector<BlockRef> blocks;
+        };
+        std::vector<Item> items;
+        std::uint64_t generation = 0;
+        bool created_files = false;
+        DecodedBlock scratch; // Bộ đệm mã hóa riêng, không dùng chung scratch_ với các luồng đọc.
+        std::chrono::steady_clock::time_point started;
+    };
+
+private:
+    std::string wal_path() const { return directory_ + "/wal.log"; }
+
+    bool fail(const std::string& message) const {
+        std::cerr << "Columnar store: " << message << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    static std::size_t padded(std::size_t size) { return (size + 7) & ~static_cast<std::size_t>(7); }
+
+    // Kích thước payload của khối thô.
+    static std::size_t payload_size(std::size_t count) {
+        return padded(count * (sizeof(std::int64_t) + kValueCount * sizeof(float) + 1));
+    }
+
+    template <typename T>
+    static void put(std::vector<char>& out, const T& value) {
+        const char* p = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), p, p + sizeof(T));
+    }
+
+    static bool read_file(const std::string& path, std::vector<char>& out) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st {};
+        ::fstat(fd, &st);
+        out.resize(static_cast<std::size_t>(st.st_size));
+        std::size_t done = 0;
+        while (done < out.size()) {
+            ssize_t n = ::read(fd, out.data() + done, out.size() - done);
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        out.resize(done);
+        ::close(fd);
+        return true;
+    }
+
+    static bool write_all(int fd, const char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    static bool sync(int fd) {
+#ifdef __linux__
+        return ::fdatasync(fd) == 0;
+#else
+        return ::fsync(fd) == 0;
+#endif
+    }
+
+    static void truncate_file(const std::string& path, std::uint64_t size) {
+        if (::truncate(path.c_str(), static_cast<off_t>(size)) != 0) {
+            std::cerr << "Columnar store: cannot truncate " << path << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    void sync_directory() const {
+        int fd = ::open(directory_.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+
+    // Ghi WAL thế hệ generation_ gồm records (các bản ghi WAL đã mã hóa) ra tệp tạm rồi đổi tên đè lên
+    // wal.log (nguyên tử).
+    bool write_new_wal(const std::vector<char>& records = {}) {
+        std::string tmp = wal_path() + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return fail("cannot create " + tmp);
+        }
+        WalHeader header{kWalMagic, 1, generation_};
+        bool ok = write_all(fd, reinterpret_cast<const char*>(&header), sizeof(header)) &&
+                  write_all(fd, records.data(), records.size()) && sync(fd);
+        ::close(fd);
+        if (!ok || ::rename(tmp.c_str(), wal_path().c_str()) != 0) {
+            return fail("cannot write " + wal_path());
+        }
+        sync_directory();
+        return true;
+    }
+
+    void append_wal_record(std::string_view device_id, const Row& row) { append_wal_record(wal_buffer_, device_id, row); }
+
+    // Bản ghi WAL: u8 độ dài ID, ID, Row (đóng gói), u32 checksum FNV-1a của các byte trước đó.
+    static void append_wal_record(std::vector<char>& out, std::string_view device_id, const Row& row) {
+        std::size_t begin = out.size();
+        out.push_back(static_cast<char>(device_id.size()));
+        out.insert(out.end(), device_id.begin(), device_id.end());
+        put(out, row.timestamp_ms);
+        for (float value : row.values) {
+            put(out, value);
+        }
+        put(out, row.prediction);
+        put(out, checksum(out.data() + begin, out.size() - begin));
+    }
+
+    // Trả segment của một thiết bị về trạng thái trước checkpoint.
+    static void undo_segment(const CheckpointPlan::Item& item) {
+        if (item.old_size == 0) {
+            ::unlink(item.path.c_str());
+        } else {
+            truncate_file(item.path, item.old_size);
+        }
+    }
+
+    // Trả về độ dài phần hợp lệ của WAL.
+    std::size_t replay_wal(const std::vector<char>& wal) {
+        constexpr std::size_t kFixed = sizeof(std::int64_t) + kValueCount * sizeof(float) + 1;
+        std::size_t p = sizeof(WalHeader);
+        while (p < wal.size()) {
+            std::size_t id_length = static_cast<unsigned char>(wal[p]);
+            std::size_t record = 1 + id_length + kFixed;
+            if (p + record + sizeof(std::uint32_t) > wal.size()) {
+                break; // Bản ghi cuối bị ghi dở khi mất điện.
+            }
+            std::uint32_t stored;
+            std::memcpy(&stored, wal.data() + p + record, sizeof(stored));
+            if (stored != checksum(wal.data() + p, record)) {
+                break;
+            }
+
+            const char* q = wal.data() + p + 1 + id_length;
+            Row row;
+            std::memcpy(&row.timestamp_ms, q, sizeof(row.timestamp_ms));
+            std::memcpy(row.values, q + sizeof(row.timestamp_ms), sizeof(row.values));
+            std::memcpy(&row.prediction, q + sizeof(row.timestamp_ms) + sizeof(row.values), 1);
+            series_[std::string(wal.data() + p + 1, id_length)].open.push_back(row);
+            ++rows_;
+            p += record + sizeof(std::uint32_t);
+        }
+        devices_ = series_.size();
+        return p;
+    }
+
+    static std::uint32_t checksum(const char* data, std::size_t size) {
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    static void append_segment_header(std::string_view device_id, std::vector<char>& out) {
+        SegmentHeader header{kSegmentMagic, 1, static_cast<std::uint16_t>(device_id.size())};
+        put(out, header);
+        out.insert(out.end(), device_id.begin(), device_id.end());
+        out.resize(padded(out.size()), 0);
+    }
+
+    // Mã hóa count bản ghi thành một khối nén nối vào out; file_offset là vị trí của out[out.size()] trong tệp.
+    // Payload: kColumnCount số u32 là độ dài (byte) luồng của từng cột, rồi các luồng nối tiếp nhau.
+    static BlockRef encode_block(const Row* rows, std::size_t count, std::uint64_t file_offset, std::uint64_t generation,
+                                 DecodedBlock& columns, std::vector<char>& out) {
+        BlockHeader header{kBlockMagic, kEncodingGorilla, 0, static_cast<std::uint32_t>(count), 0, generation,
+                           rows[0].timestamp_ms, rows[0].timestamp_ms};
+        columns.timestamps.resize(count);
+        columns.predictions.resize(count);
+        for (auto& values : columns.values) {
+            values.resize(count);
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            header.min_ts = std::min(header.min_ts, rows[i].timestamp_ms);
+            header.max_ts = std::max(header.max_ts, rows[i].timestamp_ms);
+            columns.timestamps[i] = rows[i].timestamp_ms;
+            for (int c = 0; c < kValueCount; ++c) {
+                columns.values[c][i] = rows[i].values[c];
+            }
+            columns.predictions[i] = rows[i].prediction;
+        }
+
+        std::size_t header_begin = out.size();
+        put(out, header);
+        std::size_t lengths_begin = out.size();
+        out.resize(lengths_begin + kColumnCount * sizeof(std::uint32_t));
+        std::size_t stream_begin = out.size();
+        auto end_stream = [&](int column) {
+            auto length = static_cast<std::uint32_t>(out.size() - stream_begin);
+            std::memcpy(out.data() + lengths_begin + column * sizeof(length), &length, sizeof(length));
+            stream_begin = out.size();
+        };
+        gorilla::encode_timestamps(columns.timestamps, out);
+        end_stream(0);
+        for (int c = 0; c < kValueCount; ++c) {
+            gorilla::encode_floats(columns.values[c], out);
+            end_stream(c + 1);
+        }
+        gorilla::encode_bytes(columns.predictions, out);
+        end_stream(kValueCount + 1);
+        out.resize(padded(out.size()), 0);
+
+        header.payload_bytes = static_cast<std::uint32_t>(out.size() - lengths_begin);
+        std::memcpy(out.data() + header_begin, &header, sizeof(header));
+        return {header.min_ts,     header.max_ts,  header.count, header.encoding, file_offset + sizeof(BlockHeader),
+                header.payload_bytes};
+    }
+
+    // Giải mã count bản ghi đầu của các cột trong mặt nạ columns vào scratch_; các cột khác giữ nguyên.
+    // Kết quả hợp lệ tới lần gọi sau.
+    const DecodedBlock& decode(const Series& series, const BlockRef& block, unsigned columns, std::size_t count) const {
+        DecodedBlock& out = scratch_;
+        const char* payload = series.map + block.offset;
+        out.timestamps.resize(block.count);
+        out.predictions.resize(block.count);
+        for (auto& values : out.values) {
+            values.resize(block.count);
+        }
+
+        if (block.encoding == kEncodingRaw) {
+            BlockView view(payload, block.count);
+            for (std::uint32_t i = 0; i < count; ++i) {
+                out.timestamps[i] = view.timestamp(i);
+                for (int c = 0; c < kValueCount; ++c) {
+                    out.values[c][i] = view.value(c, i);
+                }
+                out.predictions[i] = view.prediction(i);
+            }
+            return out;
+        }
+
+        std::uint32_t lengths[kColumnCount];
+        std::memcpy(lengths, payload, sizeof(lengths));
+        const char* stream = payload + sizeof(lengths);
+        const char* end = payload + block.payload_bytes;
+        for (int column = 0; column < kColumnCount; ++column) {
+            // Luồng hỏng (độ dài vượt khối) được đọc như luồng bị cắt: phần thiếu giải mã thành 0.
+            std::size_t length = std::min<std::size_t>(lengths[column], static_cast<std::size_t>(end - stream));
+            if ((columns & (1u << column)) != 0) {
+                if (column == 0) {
+                    gorilla::decode_timestamps(stream, length, out.timestamps.data(), count);
+                } else if (column == kValueCount + 1) {
+                    gorilla::decode_bytes(stream, length, out.predictions.data(), count);
+                } else {
+                    gorilla::decode_floats(stream, length, out.values[column - 1].data(), count);
+                }
+            }
+            stream += length;
+        }
+        return out;
+    }
+
+    // Nạp header của mọi segment. Phần đuôi không hợp lệ, và khi có WAL thì cả các khối thuộc thế hệ
+    // chưa checkpoint xong, được cắt khỏi tệp.
+    bool load_segments(bool have_wal) {
+        DIR* dir = ::opendir(directory_.c_str());
+        if (dir == nullptr) {
+            return fail("cannot list " + directory_);
+        }
+        std::vector<std::string> names;
+        while (dirent* entry = ::readdir(dir)) {
+            std::string_view name(entry->d_name);
+            if (name.size() > 4 && name.substr(name.size() - 4) == ".seg") {
+                names.emplace_back(name);
+                next_segment_id_ = std::max<std::uint64_t>(next_segment_id_, std::strtoull(entry->d_name, nullptr, 10) + 1);
+            }
+        }
+        ::closedir(dir);
+
+        for (const std::string& name : names) {
+            std::string path = directory_ + "/" + name;
+            std::vector<char> file;
+            read_file(path, file);
+            SegmentHeader header{};
+            if (file.size() >= sizeof(header)) {
+                std::memcpy(&header, file.data(), sizeof(header));
+            }
+            if (header.magic != kSegmentMagic || file.size() < sizeof(header) + header.device_id_length) {
+                std::cerr << "Columnar store: ignoring invalid segment " << path << std::endl;
+                continue;
+            }
+            std::string device_id(file.data() + sizeof(header), header.device_id_length);
+            Series& series = series_[device_id];
+            series.path = path;
+
+            std::size_t offset = padded(sizeof(header) + header.device_id_length);
+            while (offset + sizeof(BlockHeader) <= file.size()) {
+                BlockHeader block;
+                std::memcpy(&block, file.data() + offset, sizeof(block));
+                if (block.magic != kBlockMagic || offset + sizeof(block) + block.payload_bytes > file.size() ||
+                    (have_wal && block.generation >= generation_)) {
+                    break;
+                }
+                if (block.encoding != kEncodingRaw && block.encoding != kEncodingGorilla) {
+                    std::cerr << "Columnar store: unknown block encoding " << block.encoding << " in " << path << std::endl;
+                    break;
+                }
+                series.blocks.push_back({block.min_ts, block.max_ts, block.count, block.encoding, offset + sizeof(block),
+                                         block.payload_bytes});
+                raw_block_bytes_ += payload_size(block.count);
+                block_bytes_ += block.payload_bytes;
+                max_generation_ = std::max(max_generation_, block.generation);
+                rows_ += block.count;
+                ++blocks_;
+                offset += sizeof(block) + block.payload_bytes;
+            }
+            if (offset != file.size()) {
+                truncate_file(path, offset);
+            }
+            series.file_size = offset;
+            segment_bytes_ += offset;
+            series.remap();
+        }
+        devices_ = series_.size();
+        return true;
+    }
+
+    std::string directory_;
+    std::unordered_map<std::string, Series> series_; // Khóa là ID thiết bị.
+    std::vector<PendingRow> pending_;
+    std::vector<char> wal_buffer_; // Các bản ghi WAL của pending_, ghi ra trong một lần.
+    int wal_fd_ = -1;
+    std::uint64_t generation_ = 1;
+    std::uint64_t max_generation_ = 0;
+    std::uint64_t next_segment_id_ = 1;
+    mutable DecodedBlock scratch_; // Bộ đệm cột cho decode().
+    bool auto_checkpoint_ = true;
+
+    std::atomic<std::uint64_t> wal_bytes_{0};
+    std::atomic<std::uint64_t> segment_bytes_{0};
+    std::atomic<std::uint64_t> rows_{0};
+    std::atomic<std::uint64_t> blocks_{0};
+    std::atomic<std::uint64_t> checkpoints_{0};
+    std::atomic<std::uint64_t> last_checkpoint_us_{0};
+    std::atomic<std::uint64_t> last_checkpoint_lock_us_{0};
+    std::atomic<std::uint64_t> devices_{0};
+    std::atomic<std::uint64_t> raw_block_bytes_{0};
+    std::atomic<std::uint64_t> block_bytes_{0};
+};
+
+#endif // _WIN32
+
+#endif //DATABASE_SERVER_COLUMNAR_STORE_H
@@ -0,0 +1,119 @@
+#ifndef DATABASE_SERVER_DEVICE_HISTORY_H
+#define DATABASE_SERVER_DEVICE_HISTORY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sensor_data.h"
+
+// Các bản ghi gần nhất của một thiết bị trong bộ nhớ: bộ đệm vòng giữ tối đa capacity bản ghi và (nếu
+// window_ms > 0) chỉ những bản ghi không cũ hơn bản mới nhất quá window_ms. Khi đầy, bản mới ghi đè bản cũ
+// nhất, nên append() là O(1) và bộ nhớ của mỗi thiết bị có giới hạn dù máy chủ chạy bao lâu.
+//
+// Mỗi mẫu có kích thước cố định (không chuỗi trên heap): nhãn dự đoán lưu dưới dạng mã một byte, ghi chú
+// không được giữ (nó có trong log.txt và sensor_data). Bộ đệm lớn dần tới capacity thay vì cấp phát hết từ
+// đầu, nên thiết bị ít gửi không chiếm đủ capacity mẫu.
+//
+// Không tự đồng bộ; người gọi giữ khóa của thiết bị.
+class DeviceHistory {
+public:
+    DeviceHistory(std::size_t capacity, std::int64_t window_ms)
+        : capacity_(std::max<std::size_t>(1, capacity)), window_ms_(window_ms) {}
+
+    void append(const SensorData& data) {
+        Sample sample{data.timestamp_ms,
+                      {data.light_intensity, data.temperature, data.air_humidity, data.soil_humidity},
+                      prediction_code(data.prediction)};
+        if (window_ms_ > 0) {
+            // Mỗi mẫu bị bỏ nhiều nhất một lần, nên chi phí vẫn là O(1) khấu hao.
+            while (size_ > 0 && samples_[head_].timestamp_ms < data.timestamp_ms - window_ms_) {
+                head_ = next(head_);
+                --size_;
+            }
+        }
+        if (size_ == samples_.size() && samples_.size() < capacity_) {
+            // Xoay để bản cũ nhất ở đầu rồi mới nới bộ đệm; chỉ xảy ra cho tới khi đủ capacity.
+            std::rotate(samples_.begin(), samples_.begin() + static_cast<std::ptrdiff_t>(head_), samples_.end());
+            head_ = 0;
+            if (samples_.size() == samples_.capacity()) {
+                samples_.reserve(std::min(capacity_, std::max<std::size_t>(8, samples_.size() * 2))); // Không vượt capacity.
+            }
+            samples_.push_back(sample);
+            ++size_;
+            return;
+        }
+        if (size_ == samples_.size()) {
+            samples_[head_] = sample; // Đầy: ghi đè bản cũ nhất.
+            head_ = next(head_);
+            return;
+        }
+        samples_[(head_ + size_) % samples_.size()] = sample;
+        ++size_;
+    }
+
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return capacity_; }
+    std::size_t memory_bytes() const { return samples_.capacity() * sizeof(Sample); }
+
+    // Bản ghi mới nhất; false nếu chưa có.
+    bool latest(SensorData& out) const {
+        if (size_ == 0) {
+            return false;
+        }
+        samples_[(head_ + size_ - 1) % samples_.size()].to_sensor_data(out);
+        return true;
+    }
+
+    // Gọi fn(const SensorData&) cho các bản ghi có timestamp_ms >= from_ms, từ cũ tới mới.
+    template <typename Fn>
+    void for_each_since(std::int64_t from_ms, Fn&& fn) const {
+        SensorData data;
+        for (std::size_t i = 0; i < size_; ++i) {
+            const Sample& sample = samples_[(head_ + i) % samples_.size()];
+            if (sample.timestamp_ms >= from_ms) {
+                sample.to_sensor_data(data);
+                fn(data);
+            }
+        }
+    }
+
+    // Các bản ghi trong window_ms tính tới bản mới nhất, từ cũ tới mới.
+    std::vector<SensorData> recent(std::int64_t window_ms) const {
+        std::vector<SensorData> result;
+        SensorData newest;
+        if (!latest(newest)) {
+            return result;
+        }
+        for_each_since(newest.timestamp_ms - window_ms, [&result](const SensorData& data) { result.push_back(data); });
+        return result;
+    }
+
+private:
+    struct Sample {
+        std::int64_t timestamp_ms;
+        double values[4]; // Ánh sáng, nhiệt độ, độ ẩm không khí, độ ẩm đất.
+        std::uint8_t prediction;
+
+        void to_sensor_data(SensorData& out) const {
+            out.timestamp_ms = timestamp_ms;
+            out.light_intensity = values[0];
+            out.temperature = values[1];
+            out.air_humidity = values[2];
+            out.soil_humidity = values[3];
+            out.prediction = prediction_label(prediction);
+            out.note.clear();
+        }
+    };
+
+    std::size_t next(std::size_t index) const { return index + 1 == samples_.size() ? 0 : index + 1; }
+
+    std::size_t capacity_;
+    std::int64_t window_ms_; // 0 = chỉ giới hạn theo số lượng.
+    std::vector<Sample> samples_;
+    std::size_t head_ = 0; // Vị trí bản cũ nhất.
+    std::size_t size_ = 0;
+};
+
+#endif //DATABASE_SERVER_DEVICE_HISTORY_H
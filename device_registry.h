@@ -0,0 +1,108 @@
+#ifndef DATABASE_SERVER_DEVICE_REGISTRY_H
+#define DATABASE_SERVER_DEVICE_REGISTRY_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Danh bạ thiết bị chia thành nhiều shard theo băm của ID, mỗi shard một mutex riêng: hai luồng chỉ tranh
+// nhau khi chạm cùng một shard. Tra cứu là một lần băm trong unordered_map của shard, nhận thẳng string_view
+// (không tạo chuỗi). Khóa đọc/ghi (shared_mutex) không được dùng vì các thao tác dưới khóa rất ngắn và
+// đa số là ghi; trong device_registry_bench nó chậm hơn mutex thường.
+//
+// Device được tạo bằng make(device_id) ở lần đầu ghi vào thiết bị đó. Tham chiếu tới Device chỉ hợp lệ
+// bên trong hàm được truyền vào, khi khóa shard đang được giữ.
+template <typename Device>
+class DeviceRegistry {
+public:
+    static constexpr std::size_t kDefaultShards = 64;
+
+    using Factory = std::function<Device(const std::string&)>;
+
+    explicit DeviceRegistry(Factory make, std::size_t shards = kDefaultShards) : make_(std::move(make)) {
+        std::size_t count = 1;
+        while (count < shards) {
+            count <<= 1; // Lũy thừa của 2 để chọn shard bằng phép AND.
+        }
+        shards_.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    // Gọi fn(Device&) với khóa của shard, tạo thiết bị nếu chưa có.
+    template <typename Fn>
+    void update(const std::string& device_id, Fn&& fn) {
+        Shard& shard = shard_for(Hash{}(device_id));
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.devices.find(device_id);
+        if (it == shard.devices.end()) {
+            it = shard.devices.emplace(device_id, make_(device_id)).first;
+        }
+        fn(it->second);
+    }
+
+    // Gọi fn(const Device&) với khóa của shard; false nếu không có thiết bị.
+    template <typename Fn>
+    bool read(std::string_view device_id, Fn&& fn) const {
+        const Shard& shard = shard_for(Hash{}(device_id));
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.devices.find(device_id);
+        if (it == shard.devices.end()) {
+            return false;
+        }
+        fn(static_cast<const Device&>(it->second));
+        return true;
+    }
+
+    // Gọi fn(device_id, const Device&) cho mọi thiết bị, khóa lần lượt từng shard (không phải ảnh chụp
+    // nhất quán của cả danh bạ).
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            for (const auto& [device_id, device] : shard->devices) {
+                fn(device_id, device);
+            }
+        }
+    }
+
+    std::size_t size() const {
+        std::size_t total = 0;
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            total += shard->devices.size();
+        }
+        return total;
+    }
+
+    std::size_t shard_count() const { return shards_.size(); }
+
+private:
+    // Băm trong suốt: tra cứu bằng string_view không cần tạo std::string.
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+
+    // alignas để khóa của hai shard kề nhau không nằm chung một dòng cache.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Device, Hash, std::equal_to<>> devices;
+    };
+
+    // Trộn bit cao vào để việc chọn shard không chỉ dựa vào các bit thấp mà unordered_map trong shard cũng dùng.
+    Shard& shard_for(std::size_t hash) const {
+        return *shards_[(hash ^ (hash >> (sizeof(std::size_t) * 4))) & (shards_.size() - 1)]; // Nửa cao, cả với size_t 32 bit.
+    }
+
+    Factory make_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif //DATABASE_SERVER_DEVICE_REGISTRY_H
@@ -0,0 +1,154 @@
+#ifndef DATABASE_SERVER_FRAME_READER_H
+#define DATABASE_SERVER_FRAME_READER_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "wire_protocol.h"
+
+// Tách luồng byte của một kết nối thành các bản ghi hoàn chỉnh.
+//
+// Các kiểu đóng khung được hỗ trợ, xác định bằng byte đầu tiên của kết nối:
+//  - Mặc định: mỗi bản ghi văn bản kết thúc bằng '\n' (chấp nhận cả "\r\n").
+//  - Byte đầu là kLengthPrefixMagic: mỗi khung gồm độ dài 2 byte big-endian rồi đến nội dung.
+//  - Byte đầu là magic nhị phân (kBinaryMagicV1/kBatchMagicV1/kSequencedMagicV1): các khung tự mô tả độ dài (xem wire_protocol.h).
+//
+// Dữ liệu có thể đến theo từng mảnh bất kỳ: một bản ghi bị chia qua nhiều lần đọc sẽ được giữ lại
+// cho tới khi đủ, và một lần đọc có thể chứa nhiều bản ghi.
+class FrameReader {
+public:
+    static constexpr unsigned char kLengthPrefixMagic = 0xA5;
+    static constexpr std::size_t kMaxFrameSize = 4096; // Khung dài hơn được coi là dữ liệu hỏng.
+
+    enum class Framing { Unknown, Newline, LengthPrefixed, Binary };
+
+    // Thêm dữ liệu vừa đọc được từ socket vào bộ đệm.
+    void append(const char* data, std::size_t len) {
+        if (read_pos_ > 0 && read_pos_ * 2 >= buffer_.size()) {
+            buffer_.erase(0, read_pos_); // Dồn bộ đệm để không phình ra trên kết nối dài hạn.
+            read_pos_ = 0;
+        }
+        buffer_.append(data, len);
+    }
+
+    // Trả về khung hoàn chỉnh tiếp theo, hoặc std::nullopt nếu cần đọc thêm dữ liệu.
+    // string_view trả về chỉ hợp lệ đến lần gọi append() kế tiếp.
+    std::optional<std::string_view> next() {
+        if (framing_ == Framing::Unknown) {
+            if (read_pos_ >= buffer_.size()) {
+                return std::nullopt;
+            }
+            auto first = static_cast<unsigned char>(buffer_[read_pos_]);
+            if (first == kLengthPrefixMagic) {
+                framing_ = Framing::LengthPrefixed;
+                ++read_pos_;
+            } else if (WireProtocol::is_binary_magic(first)) {
+                framing_ = Framing::Binary; // Byte magic thuộc về khung nên không bỏ qua.
+            } else {
+                framing_ = Framing::Newline;
+            }
+        }
+
+        switch (framing_) {
+            case Framing::LengthPrefixed:
+                return next_length_prefixed();
+            case Framing::Binary:
+                return next_binary();
+            default:
+                return next_line();
+        }
+    }
+
+    // Gọi khi đối phương đã đóng chiều gửi: trả về phần dữ liệu còn lại chưa có ký tự kết thúc,
+    // để các firmware cũ gửi một bản ghi không có '\n' rồi đóng kết nối vẫn hoạt động.
+    std::optional<std::string_view> take_remainder() {
+        if (framing_ != Framing::Newline || read_pos_ >= buffer_.size()) {
+            return std::nullopt;
+        }
+        std::string_view rest = trim_line(std::string_view(buffer_).substr(read_pos_));
+        read_pos_ = buffer_.size();
+        if (rest.empty()) {
+            return std::nullopt;
+        }
+        return rest;
+    }
+
+    // true nếu dữ liệu đang chờ vượt quá kích thước khung cho phép hoặc khung nhị phân sai định dạng.
+    // Sau đó không thể đồng bộ lại luồng nên kết nối cần được đóng.
+    bool corrupted() const { return corrupted_; }
+
+    Framing framing() const { return framing_; }
+
+    // true nếu còn dữ liệu của một khung chưa đến đủ.
+    bool has_partial_frame() const { return read_pos_ < buffer_.size(); }
+
+private:
+    std::optional<std::string_view> next_line() {
+        while (read_pos_ < buffer_.size()) {
+            size_t end = buffer_.find('\n', read_pos_);
+            if (end == std::string::npos) {
+                corrupted_ = buffer_.size() - read_pos_ > kMaxFrameSize;
+                return std::nullopt;
+            }
+
+            std::string_view line = trim_line(std::string_view(buffer_).substr(read_pos_, end - read_pos_));
+            read_pos_ = end + 1;
+            if (!line.empty()) { // Bỏ qua dòng trống (dùng làm keep-alive).
+                return line;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::string_view> next_length_prefixed() {
+        if (buffer_.size() - read_pos_ < 2) {
+            return std::nullopt;
+        }
+
+        auto hi = static_cast<unsigned char>(buffer_[read_pos_]);
+        auto lo = static_cast<unsigned char>(buffer_[read_pos_ + 1]);
+        std::size_t frame_len = (static_cast<std::size_t>(hi) << 8) | lo;
+        if (frame_len > kMaxFrameSize) {
+            corrupted_ = true;
+            return std::nullopt;
+        }
+        if (buffer_.size() - read_pos_ - 2 < frame_len) {
+            return std::nullopt; // Khung chưa đến đủ.
+        }
+
+        std::string_view frame = std::string_view(buffer_).substr(read_pos_ + 2, frame_len);
+        read_pos_ += 2 + frame_len;
+        return frame;
+    }
+
+    std::optional<std::string_view> next_binary() {
+        std::string_view pending = std::string_view(buffer_).substr(read_pos_);
+        std::size_t frame_len = WireProtocol::binary_frame_size(pending);
+        if (frame_len == WireProtocol::kInvalidFrame) {
+            corrupted_ = true;
+            return std::nullopt;
+        }
+        if (frame_len == WireProtocol::kNeedMoreData) {
+            return std::nullopt;
+        }
+
+        read_pos_ += frame_len;
+        return pending.substr(0, frame_len);
+    }
+
+    static std::string_view trim_line(std::string_view line) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+            line.remove_suffix(1);
+        }
+        return line;
+    }
+
+    std::string buffer_; // Dữ liệu đã nhận nhưng chưa tiêu thụ hết.
+    std::size_t read_pos_ = 0; // Vị trí bắt đầu của phần chưa tiêu thụ trong buffer_.
+    Framing framing_ = Framing::Unknown;
+    bool corrupted_ = false;
+};
+
+#endif //DATABASE_SERVER_FRAME_READER_H
@@ -0,0 +1,259 @@
+#ifndef DATABASE_SERVER_GORILLA_CODEC_H
+#define DATABASE_SERVER_GORILLA_CODEC_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// Nén chuỗi thời gian kiểu Gorilla (Facebook, VLDB 2015): dấu thời gian lưu theo delta-of-delta, giá trị
+// float lưu theo XOR với giá trị trước. Bản ghi cảm biến đều đặn và ít thay đổi nên phần lớn chỉ tốn
+// 1-2 bit cho mỗi cột. Mỗi cột là một luồng bit riêng, bắt đầu ở biên byte, để đọc một cột không phải
+// giải mã các cột khác.
+namespace gorilla {
+
+// Ghi bit theo thứ tự từ bit cao xuống bit thấp vào một vector byte.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<char>& out) : out_(out) {}
+
+    // Ghi n bit thấp của value, 0 <= n <= 64.
+    void write(std::uint64_t value, int n) {
+        if (n > 32) {
+            write(value >> 32, n - 32);
+            n = 32;
+        }
+        if (n == 0) {
+            return;
+        }
+        buffer_ = (buffer_ << n) | (value & (~std::uint64_t{0} >> (64 - n)));
+        bits_ += n;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_.push_back(static_cast<char>(buffer_ >> bits_));
+        }
+    }
+
+    void write_bit(bool bit) { write(bit ? 1 : 0, 1); }
+
+    // Đẩy các bit còn lại ra, đệm 0 cho đủ byte cuối.
+    void flush() {
+        if (bits_ > 0) {
+            out_.push_back(static_cast<char>(buffer_ << (8 - bits_)));
+            bits_ = 0;
+        }
+    }
+
+private:
+    std::vector<char>& out_;
+    std::uint64_t buffer_ = 0;
+    int bits_ = 0;
+};
+
+// Đọc lại luồng của BitWriter. Đọc quá cuối luồng trả về bit 0 thay vì ra ngoài vùng nhớ.
+class BitReader {
+public:
+    BitReader(const char* data, std::size_t size)
+        : p_(reinterpret_cast<const unsigned char*>(data)), end_(p_ + size) {}
+
+    // Đọc n bit, 0 <= n <= 64.
+    std::uint64_t read(int n) {
+        if (n > 32) {
+            std::uint64_t high = read(n - 32);
+            return (high << 32) | read(32);
+        }
+        if (n == 0) {
+            return 0;
+        }
+        if (bits_ < n) {
+            refill();
+        }
+        std::uint64_t value = buffer_ >> (64 - n);
+        buffer_ <<= n;
+        bits_ -= n;
+        return value;
+    }
+
+    bool read_bit() { return read(1) != 0; }
+
+    // Đếm số bit 1 liên tiếp, tối đa max (<= 32), và bỏ qua bit 0 kết thúc (nếu có). Dùng cho mã tiền tố.
+    int read_prefix(int max) {
+        if (bits_ < max + 1) {
+            refill();
+        }
+        int ones = std::min(std::countl_one(buffer_), max);
+        int used = ones < max ? ones + 1 : max;
+        buffer_ <<= used;
+        bits_ -= used;
+        return ones;
+    }
+
+private:
+    // Nạp thêm byte cho tới khi bộ đệm có ít nhất 56 bit. Khi còn đủ 8 byte thì nạp một lần cả từ; các bit
+    // của byte nạp dở nằm sẵn đúng chỗ trong bộ đệm nên lần nạp sau OR lại đúng giá trị đó.
+    void refill() {
+        if (end_ - p_ >= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, p_, sizeof(word));
+            if constexpr (std::endian::native == std::endian::little) {
+                word = std::byteswap(word);
+            }
+            buffer_ |= word >> bits_;
+            int bytes = (63 - bits_) >> 3;
+            p_ += bytes;
+            bits_ += bytes * 8;
+            return;
+        }
+        while (bits_ <= 56) {
+            std::uint64_t byte = p_ < end_ ? *p_++ : 0;
+            buffer_ |= byte << (56 - bits_);
+            bits_ += 8;
+        }
+    }
+
+    const unsigned char* p_;
+    const unsigned char* end_;
+    std::uint64_t buffer_ = 0;
+    int bits_ = 0;
+};
+
+inline std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+// Độ rộng của các nhóm delta-of-delta (sau zigzag), theo mã tiền tố 0, 10, 110, 1110, 1111. Dấu thời gian
+// là mili giây lúc bản ghi tới máy chủ nên độ lệch so với chu kỳ gửi thường vài chục ms: rộng hơn bản gốc
+// (vốn tính theo giây).
+constexpr int kDeltaWidths[] = {0, 7, 12, 20, 64};
+
+// Dấu thời gian đầu tiên lưu nguyên 64 bit; các dấu sau lưu hiệu của delta với delta trước.
+// Không cần tăng dần: bản ghi đến trễ chỉ tốn nhóm rộng hơn.
+inline void encode_timestamps(std::span<const std::int64_t> timestamps, std::vector<char>& out) {
+    BitWriter writer(out);
+    std::uint64_t previous = 0;
+    std::uint64_t previous_delta = 0;
+    for (std::size_t i = 0; i < timestamps.size(); ++i) {
+        auto current = static_cast<std::uint64_t>(timestamps[i]);
+        if (i == 0) {
+            writer.write(current, 64);
+        } else {
+            std::uint64_t delta = current - previous;
+            std::uint64_t encoded = zigzag(static_cast<std::int64_t>(delta - previous_delta));
+            int group = 0;
+            while (group < 4 && encoded >> kDeltaWidths[group] != 0) {
+                ++group;
+            }
+            // group bit 1 rồi một bit 0; nhóm cuối chỉ có bốn bit 1.
+            writer.write(group == 4 ? 0b1111 : (std::uint64_t{1} << (group + 1)) - 2, group == 4 ? 4 : group + 1);
+            writer.write(encoded, kDeltaWidths[group]);
+            previous_delta = delta;
+        }
+        previous = current;
+    }
+    writer.flush();
+}
+
+inline void decode_timestamps(const char* data, std::size_t size, std::int64_t* out, std::size_t count) {
+    BitReader reader(data, size);
+    std::uint64_t previous = 0;
+    std::uint64_t delta = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i == 0) {
+            previous = reader.read(64);
+        } else {
+            int group = reader.read_prefix(4);
+            delta += static_cast<std::uint64_t>(unzigzag(reader.read(kDeltaWidths[group])));
+            previous += delta;
+        }
+        out[i] = static_cast<std::int64_t>(previous);
+    }
+}
+
+// Giá trị đầu tiên lưu nguyên 32 bit. Mỗi giá trị sau lưu XOR với giá trị trước:
+//   0                          giống hệt giá trị trước;
+//   10 + bit có nghĩa           các bit khác 0 nằm trong cửa sổ (leading, trailing) của lần trước;
+//   11 + 5 bit leading + 5 bit (độ dài - 1) + bit có nghĩa   cửa sổ mới.
+inline void encode_floats(std::span<const float> values, std::vector<char>& out) {
+    BitWriter writer(out);
+    std::uint32_t previous = 0;
+    int window_leading = -1; // -1 = chưa có cửa sổ.
+    int window_length = 0;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        auto current = std::bit_cast<std::uint32_t>(values[i]);
+        if (i == 0) {
+            writer.write(current, 32);
+        } else if (std::uint32_t x = current ^ previous; x == 0) {
+            writer.write_bit(false);
+        } else {
+            int leading = std::countl_zero(x);
+            int trailing = std::countr_zero(x);
+            if (window_leading >= 0 && leading >= window_leading && trailing >= 32 - window_leading - window_length) {
+                writer.write(0b10, 2);
+                writer.write(x >> (32 - window_leading - window_length), window_length);
+            } else {
+                window_leading = leading;
+                window_length = 32 - leading - trailing;
+                writer.write(0b11, 2);
+                writer.write(static_cast<std::uint64_t>(window_leading), 5);
+                writer.write(static_cast<std::uint64_t>(window_length - 1), 5);
+                writer.write(x >> trailing, window_length);
+            }
+        }
+        previous = current;
+    }
+    writer.flush();
+}
+
+inline void decode_floats(const char* data, std::size_t size, float* out, std::size_t count) {
+    BitReader reader(data, size);
+    std::uint32_t previous = 0;
+    int window_leading = 0;
+    int window_length = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i == 0) {
+            previous = static_cast<std::uint32_t>(reader.read(32));
+        } else if (int control = reader.read_prefix(2); control != 0) {
+            if (control == 2) {
+                window_leading = static_cast<int>(reader.read(5));
+                window_length = static_cast<int>(reader.read(5)) + 1;
+            }
+            previous ^= static_cast<std::uint32_t>(reader.read(window_length)) << (32 - window_leading - window_length);
+        }
+        out[i] = std::bit_cast<float>(previous);
+    }
+}
+
+// Cột byte (nhãn dự đoán): 0 = giống byte trước, 1 + 8 bit = byte mới.
+inline void encode_bytes(std::span<const std::uint8_t> values, std::vector<char>& out) {
+    BitWriter writer(out);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (i > 0 && values[i] == values[i - 1]) {
+            writer.write_bit(false);
+        } else {
+            writer.write(0x100 | values[i], 9);
+        }
+    }
+    writer.flush();
+}
+
+inline void decode_bytes(const char* data, std::size_t size, std::uint8_t* out, std::size_t count) {
+    BitReader reader(data, size);
+    std::uint8_t previous = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (reader.read_bit()) {
+            previous = static_cast<std::uint8_t>(reader.read(8));
+        }
+        out[i] = previous;
+    }
+}
+
+} // namespace gorilla
+
+#endif //DATABASE_SERVER_GORILLA_CODEC_H
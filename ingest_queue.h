@@ -0,0 +1,261 @@
+#ifndef DATABASE_SERVER_INGEST_QUEUE_H
+#define DATABASE_SERVER_INGEST_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+// Hàng đợi vòng có giới hạn, không khóa, nhiều luồng ghi - một luồng đọc (theo thiết kế của D. Vyukov).
+// Mỗi ô mang một số thứ tự cho biết ô đang trống (chờ ghi) hay đã đầy (chờ đọc), nên luồng ghi chỉ
+// cần một compare_exchange trên vị trí ghi và không bao giờ chờ luồng đọc.
+template <typename T>
+class BoundedMpscQueue {
+public:
+    explicit BoundedMpscQueue(std::size_t capacity)
+            : capacity_(round_up_pow2(capacity)), mask_(capacity_ - 1), cells_(new Cell[capacity_]) {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Trả về false nếu hàng đợi đã đầy; value không bị thay đổi trong trường hợp đó.
+    bool try_push(T& value) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // Ô vẫn còn dữ liệu chưa được đọc: hàng đợi đầy.
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Chỉ được gọi từ một luồng đọc duy nhất.
+    std::optional<T> try_pop() {
+        Cell& cell = cells_[dequeue_pos_ & mask_];
+        std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence != dequeue_pos_ + 1) {
+            return std::nullopt;
+        }
+
+        std::optional<T> value(std::move(cell.value));
+        cell.value = T{};
+        cell.sequence.store(dequeue_pos_ + capacity_, std::memory_order_release);
+        ++dequeue_pos_;
+        dequeue_pos_published_.store(dequeue_pos_, std::memory_order_release);
+        return value;
+    }
+
+    // Số phần tử đang chờ (xấp xỉ khi có luồng ghi đồng thời).
+    std::size_t size() const {
+        std::size_t enqueued = enqueue_pos_.load(std::memory_order_acquire);
+        std::size_t dequeued = dequeue_pos_published_.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    std::size_t capacity() const { return capacity_; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    static std::size_t round_up_pow2(std::size_t value) {
+        std::size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0}; // Tách dòng cache giữa luồng ghi và luồng đọc.
+    alignas(64) std::size_t dequeue_pos_ = 0;
+    std::atomic<std::size_t> dequeue_pos_published_{0};
+};
+
+// Chính sách khi hàng đợi vượt ngưỡng cao.
+enum class OverloadPolicy {
+    Drop, // Bỏ bản ghi mới, không báo cho thiết bị.
+    Reject, // Bỏ bản ghi mới và gửi phản hồi lỗi cho thiết bị.
+    Backpressure, // Nhận bản ghi nhưng tạm ngừng đọc từ kết nối cho đến khi xuống dưới ngưỡng thấp.
+};
+
+inline std::optional<OverloadPolicy> parse_overload_policy(std::string_view name) {
+    if (name == "drop") return OverloadPolicy::Drop;
+    if (name == "reject") return OverloadPolicy::Reject;
+    if (name == "backpressure") return OverloadPolicy::Backpressure;
+    return std::nullopt;
+}
+
+inline const char* overload_policy_name(OverloadPolicy policy) {
+    switch (policy) {
+        case OverloadPolicy::Drop: return "drop";
+        case OverloadPolicy::Reject: return "reject";
+        default: return "backpressure";
+    }
+}
+
+// Hàng đợi nhập liệu giữa tầng mạng và tầng xử lý, có kiểm soát tiếp nhận.
+// Khi độ sâu chạm ngưỡng cao, hàng đợi vào trạng thái quá tải và chỉ thoát khi xuống tới ngưỡng thấp
+// (trễ hai ngưỡng để không dao động liên tục quanh một giá trị).
+template <typename T>
+class IngestQueue {
+public:
+    enum class Admission {
+        Accepted, // Đã vào hàng đợi.
+        AcceptedThrottle, // Đã vào hàng đợi, nhưng nơi gửi nên tạm ngừng đọc (Backpressure).
+        Shed, // Bị bỏ do quá tải.
+    };
+
+    IngestQueue(std::size_t capacity, std::size_t high_watermark, std::size_t low_watermark, OverloadPolicy policy)
+            : queue_(capacity),
+              high_watermark_(std::min(high_watermark, queue_.capacity())),
+              low_watermark_(std::min(low_watermark, high_watermark_)),
+              policy_(policy) {}
+
+    // Gọi từ các luồng mạng. Với Backpressure, bản ghi chỉ bị bỏ khi hàng đợi thực sự đầy.
+    Admission push(T& item) {
+        std::size_t depth = queue_.size();
+        if (depth >= high_watermark_) {
+            overloaded_.store(true, std::memory_order_relaxed);
+        }
+
+        bool overloaded = overloaded_.load(std::memory_order_relaxed);
+        if (overloaded && policy_ != OverloadPolicy::Backpressure) {
+            shed_.fetch_add(1, std::memory_order_relaxed);
+            return Admission::Shed;
+        }
+        if (!queue_.try_push(item)) {
+            overloaded_.store(true, std::memory_order_relaxed);
+            shed_.fetch_add(1, std::memory_order_relaxed);
+            return Admission::Shed;
+        }
+
+        enqueued_.fetch_add(1, std::memory_order_relaxed);
+        update_max_depth(depth + 1);
+        wake_consumer();
+        return overloaded ? Admission::AcceptedThrottle : Admission::Accepted;
+    }
+
+    // Gọi từ luồng xử lý duy nhất: chờ cho đến khi có phần tử.
+    T pop_wait() {
+        while (true) {
+            if (std::optional<T> item = pop_or_sleep([this](std::unique_lock<std::mutex>& lock) {
+                    wake_.wait(lock, [this] { return signaled_; });
+                })) {
+                return std::move(*item);
+            }
+        }
+    }
+
+    // Gọi từ luồng xử lý duy nhất: chờ phần tử tới tối đa deadline.
+    template <typename Clock, typename Duration>
+    std::optional<T> pop_until(std::chrono::time_point<Clock, Duration> deadline) {
+        while (Clock::now() < deadline) {
+            if (std::optional<T> item = pop_or_sleep([&](std::unique_lock<std::mutex>& lock) {
+                    wake_.wait_until(lock, deadline, [this] { return signaled_; });
+                })) {
+                return item;
+            }
+        }
+        return try_pop();
+    }
+
+    std::optional<T> try_pop() {
+        std::optional<T> item = queue_.try_pop();
+        if (item && overloaded_.load(std::memory_order_relaxed) && queue_.size() <= low_watermark_) {
+            overloaded_.store(false, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    bool overloaded() const { return overloaded_.load(std::memory_order_relaxed); }
+    OverloadPolicy policy() const { return policy_; }
+    std::size_t depth() const { return queue_.size(); }
+    std::size_t capacity() const { return queue_.capacity(); }
+    std::size_t high_watermark() const { return high_watermark_; }
+    std::size_t low_watermark() const { return low_watermark_; }
+    std::uint64_t enqueued() const { return enqueued_.load(std::memory_order_relaxed); }
+    std::uint64_t shed() const { return shed_.load(std::memory_order_relaxed); }
+    std::size_t max_depth() const { return max_depth_.load(std::memory_order_relaxed); }
+
+private:
+    // Lấy một phần tử; nếu hàng đợi trống thì gọi sleep(lock) để chờ wake_ tới khi một luồng ghi đánh thức
+    // (hoặc hết hạn chờ) rồi trả về nullopt để người gọi thử lại.
+    //
+    // consumer_waiting_ báo cho luồng ghi biết luồng đọc sắp ngủ, nên khi luồng đọc đang bận (hàng đợi có
+    // dữ liệu) luồng ghi không phải khóa mutex hay gọi notify. Hai hàng rào seq_cst (ở đây và trong
+    // wake_consumer) bảo đảm ít nhất một bên thấy bên kia: hoặc luồng đọc thấy phần tử mới ở lần try_pop
+    // thứ hai, hoặc luồng ghi thấy consumer_waiting_ và đánh thức nó.
+    template <typename Sleep>
+    std::optional<T> pop_or_sleep(Sleep&& sleep) {
+        if (std::optional<T> item = try_pop()) {
+            return item;
+        }
+        consumer_waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::optional<T> item = try_pop();
+        if (!item) {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            sleep(lock);
+            signaled_ = false;
+        }
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+        return item;
+    }
+
+    void wake_consumer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!consumer_waiting_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            signaled_ = true;
+        }
+        wake_.notify_one();
+    }
+
+    void update_max_depth(std::size_t depth) {
+        std::size_t current = max_depth_.load(std::memory_order_relaxed);
+        while (depth > current && !max_depth_.compare_exchange_weak(current, depth, std::memory_order_relaxed)) {
+        }
+    }
+
+    BoundedMpscQueue<T> queue_;
+    const std::size_t high_watermark_;
+    const std::size_t low_watermark_;
+    const OverloadPolicy policy_;
+    std::atomic<bool> overloaded_{false};
+    std::atomic<bool> consumer_waiting_{false}; // Luồng đọc đã thấy hàng đợi trống và có thể đang ngủ.
+    std::mutex wake_mutex_; // Chỉ dùng khi luồng đọc ngủ/thức, không nằm trên đường ghi thông thường.
+    std::condition_variable wake_;
+    bool signaled_ = false; // Được bảo vệ bởi wake_mutex_.
+    std::atomic<std::uint64_t> enqueued_{0};
+    std::atomic<std::uint64_t> shed_{0};
+    std::atomic<std::size_t> max_depth_{0};
+};
+
+#endif //DATABASE_SERVER_INGEST_QUEUE_H
@@ -10,141 +10,1437 @@
 #include <algorithm> // Thư viện cho các phép toán trên dãy số hoặc dãy phần tử.
 #include <cstdlib> // Thư viện cho các chức năng hệ thống và chuỗi ngẫu nhiên.
 #include <iomanip> // Thư viện cho định dạng và đầu ra đẹp hơn.
+#include <memory> // Thư viện cho con trỏ thông minh (shared_ptr).
+#include <array> // Thư viện cho mảng cố định kích thước.
+#include <chrono> // Thư viện cho thời gian và bộ định thời.
+#include <cstring> // Thư viện cho memcpy.
+#include <sstream> // Thư viện cho luồng chuỗi.
+#include <charconv> // Thư viện cho from_chars.
+#include <functional> // Thư viện cho std::function.
+#include <optional> // Thư viện cho std::optional.
+#include <unordered_map> // Thư viện cho bảng băm.
+#include <atomic> // Thư viện cho biến nguyên tử.
+#include <iterator> // Thư viện cho back_inserter.
+#include <deque> // Thư viện cho hàng đợi phản hồi chờ gửi của kết nối.
+
+#ifdef __linux__
+#include <sys/socket.h> // recvmmsg() để nhận nhiều datagram trong một lời gọi hệ thống.
+#include <pthread.h> // pthread_setaffinity_np() để gắn luồng vào lõi CPU.
+#include <sched.h>
+#endif
+
+#include "server_config.h" // Cấu hình khởi động của máy chủ.
+#include "frame_reader.h" // Tách luồng dữ liệu của kết nối thành từng bản ghi.
+#include "wire_protocol.h" // Định dạng khung nhị phân.
+#include "ingest_queue.h" // Hàng đợi nhập liệu có giới hạn giữa tầng mạng và tầng xử lý.
+#include "reading_parser.h" // Bộ phân tích bản ghi văn bản.
+#include "sensor_data.h" // SensorData và DeviceReading.
+#include "storage_backend.h" // Giao diện nơi lưu bản ghi cảm biến.
+#include "sqlite_backend.h" // Bảng sensor_data trong lora.db.
+#include "columnar_backend.h" // Kho chuỗi thời gian dạng cột (chỉ trên POSIX).
+#include "memory_backend.h" // Lưu trong bộ nhớ, để đo thông lượng CPU.
+#include "sqlite_read_pool.h" // Nhóm kết nối chỉ đọc cho truy vấn.
+#include "device_history.h" // Bộ đệm vòng các bản ghi gần nhất của mỗi thiết bị.
+#include "device_registry.h" // Danh bạ thiết bị chia shard.
+#include "uring_backend.h" // Tầng I/O io_uring (chỉ khi biên dịch với LORA_WITH_IO_URING).
 
 using namespace boost::asio; // Sử dụng không gian tên boost::asio cho đồng bộ hóa mạng.
 using ip::tcp; // Sử dụng giao thức TCP/IP.
-
-class SensorData { // Định nghĩa lớp SensorData cho dữ liệu cảm biến.
-public:
-    double light_intensity{}; // Độ sáng ánh sáng.
-    double temperature{}; // Nhiệt độ.
-    double air_humidity{}; // Độ ẩm không khí.
-    double soil_humidity{}; // Độ ẩm đất.
-    std::string timestamp; // Dấu thời gian.
-    std::string prediction; // Dự đoán.
-    std::string note; // Ghi chú.
-};
+using ip::udp; // Sử dụng giao thức UDP cho dữ liệu kiểu "gửi rồi quên".
 
 class UserControlData { // Định nghĩa lớp UserControlData cho dữ liệu điều khiển người dùng.
 public:
     int id; // ID.
     std::string device_id; // ID thiết bị.
     std::string command; // Lệnh điều khiển.
-    std::string timestamp; // Dấu thời gian.
+    std::int64_t timestamp_ms; // Dấu thời gian, mili giây kể từ epoch (UTC).
 
-    UserControlData() : id(0) {} // Hàm tạo mặc định.
+    UserControlData() : id(0), timestamp_ms(0) {} // Hàm tạo mặc định.
 };
 
 class DeviceData { // Định nghĩa lớp DeviceData cho dữ liệu thiết bị.
 public:
+    DeviceData(std::string id, std::size_t history_size, std::int64_t history_window_ms)
+        : device_id(std::move(id)), history(history_size, history_window_ms) {}
+
     std::string device_id; // ID thiết bị.
-    std::vector<SensorData> sensor_data_history; // Lịch sử dữ liệu cảm biến.
+    DeviceHistory history; // Các bản ghi cảm biến gần nhất (--history-size, --history-window).
+};
+
+class IngestItem { // Một đơn vị công việc trong hàng đợi nhập liệu: một bản ghi hoặc cả một lô.
+public:
+    std::string client_ip; // Địa chỉ IP của nơi gửi.
+    std::vector<DeviceReading> readings; // Các bản ghi đã phân tích.
+    std::function<void(std::size_t)> on_stored; // Gọi trên luồng xử lý sau khi đã ghi; có thể rỗng.
 };
 
 class LoRaServer { // Định nghĩa lớp LoRaServer cho máy chủ LoRa.
 public:
-    LoRaServer(const std::string& server_ip, unsigned short server_port)
-            : acceptor_(io_service_, tcp::endpoint(ip::address::from_string(server_ip), server_port)) {
-        std::cout << "Server IP address: " << server_ip << ", Port: " << server_port << std::endl; // In địa chỉ IP và cổng máy chủ.
+    explicit LoRaServer(const ServerConfig& config)
+            : config_(config),
+              acceptor_(io_service_),
+              lora_devices([this](const std::string& device_id) {
+                  return DeviceData(device_id, config_.history_size,
+                                    static_cast<std::int64_t>(config_.history_window_seconds) * 1000);
+              }),
+              udp_socket_(io_service_),
+              metrics_timer_(io_service_),
+              ingest_queue_(config.queue_capacity, config.queue_high_watermark, config.queue_low_watermark,
+                            config.overload_policy) {
+        std::cout << "Server IP address: " << config.server_ip << ", Port: " << config.server_port
+                  << ", Worker threads: " << config.worker_threads << std::endl; // In địa chỉ IP, cổng và số luồng xử lý.
+        if (config.acceptor_shards > 0) {
+            std::cout << "SO_REUSEPORT acceptor shards: " << config.acceptor_shards << std::endl;
+        }
+        if (config.io_backend == IoBackend::Uring) {
+            std::cout << "I/O backend: io_uring" << std::endl;
+        }
+        if (config.udp_port != 0) {
+            std::cout << "UDP listener on port " << config.udp_port << std::endl;
+        }
+        std::cout << "Read/idle timeout: " << config.read_timeout_seconds << "s/" << config.idle_timeout_seconds
+                  << "s, max connections per IP: " << config.max_connections_per_ip << std::endl;
+        std::cout << "Group commit: up to " << config.commit_batch_rows << " rows or "
+                  << config.commit_interval_ms << " ms" << std::endl;
+        if (config.raw_retention_days > 0) {
+            std::cout << "Raw retention: " << config.raw_retention_days << " days, pruned in batches of "
+                      << config.retention_batch_rows << " rows every " << config.retention_interval_seconds << "s" << std::endl;
+        }
+        std::cout << "Ingest queue capacity: " << ingest_queue_.capacity()
+                  << ", high/low watermark: " << ingest_queue_.high_watermark() << "/" << ingest_queue_.low_watermark()
+                  << ", overload policy: " << overload_policy_name(config.overload_policy) << std::endl;
     }
 
     void start() { // Bắt đầu máy chủ.
-        create_sensor_data_table(); // Tạo bảng dữ liệu cảm biến.
+        open_storage(); // Mở nơi lưu bản ghi cảm biến.
+        start_queries(); // Nhóm luồng và kết nối chỉ đọc cho "QUERY ...".
+
+        std::vector<std::thread> workers;
+        std::size_t io_service_threads = config_.worker_threads;
+
+        // Luồng xử lý duy nhất lấy bản ghi từ hàng đợi nhập liệu; tầng mạng không bao giờ chờ SQLite.
+        workers.emplace_back([this]() { run_ingest_worker(); });
+        storage_->start_background(workers);
+
+        if (start_uring(workers)) {
+            io_service_threads = 1; // Kết nối TCP do các vòng io_uring phục vụ; io_service_ chỉ còn UDP và bộ định thời.
+        } else if (config_.acceptor_shards > 0 && reuse_port_supported()) {
+            // Mỗi shard có acceptor riêng cùng bind một cổng; nhân hệ điều hành tự chia kết nối cho các shard
+            // nên không có khóa accept dùng chung. Kết nối được phục vụ trọn vẹn trên io_context của shard nhận nó.
+            for (std::size_t i = 0; i < config_.acceptor_shards; ++i) {
+                auto shard = std::make_unique<AcceptorShard>();
+                open_acceptor(shard->acceptor, true);
+                do_accept(shard->acceptor);
+                shards_.push_back(std::move(shard));
+            }
+            for (std::size_t i = 0; i < shards_.size(); ++i) {
+                workers.emplace_back([this, i]() { shards_[i]->context.run(); });
+                pin_to_core(workers.back(), i);
+            }
+            io_service_threads = 1; // io_service_ chỉ còn phục vụ UDP và bộ định thời.
+        } else {
+            if (config_.acceptor_shards > 0) {
+                std::cerr << "SO_REUSEPORT is not supported on this platform, using a single acceptor." << std::endl;
+            }
+            open_acceptor(acceptor_, false);
+            do_accept(acceptor_); // Đăng ký thao tác chấp nhận kết nối bất đồng bộ đầu tiên.
+        }
 
-        while (true) { // Vòng lặp vô hạn.
-            tcp::socket socket(io_service_); // Tạo socket TCP.
-            acceptor_.accept(socket); // Chấp nhận kết nối từ client.
+        start_udp(); // Mở cổng UDP nếu được cấu hình.
+        schedule_metrics_report(); // In số liệu thống kê định kỳ.
 
-            std::thread(&LoRaServer::handle_request, this, std::move(socket)).detach(); // Bắt đầu một luồng mới để xử lý yêu cầu từ client.
+        // Nhóm luồng cố định cùng chạy io_service_, thay cho việc tạo một luồng cho mỗi kết nối.
+        for (std::size_t i = 0; i < io_service_threads; ++i) {
+            workers.emplace_back([this]() { io_service_.run(); });
+        }
+
+        for (std::thread& worker : workers) {
+            worker.join();
         }
     }
 
 private:
+    // Phần giao thức của một kết nối: tách khung, giải mã, đưa bản ghi vào hàng đợi nhập liệu và phản hồi.
+    // Không phụ thuộc tầng I/O; Connection (Asio) và UringConnection (io_uring) lo phần truyền nhận.
+    class Session {
+    public:
+        virtual ~Session() {
+            release();
+        }
+
+    protected:
+        explicit Session(LoRaServer& server) : server_(server), last_activity_(std::chrono::steady_clock::now()) {}
+
+        // Giữ một chỗ trong giới hạn kết nối theo IP. Trả về false nếu IP này đã dùng hết giới hạn.
+        bool admit() {
+            admitted_ = server_.admit_connection(client_ip_);
+            return admitted_;
+        }
+
+        // Trả chỗ khi kết nối đóng; gọi nhiều lần cũng không sao.
+        void release() {
+            if (admitted_) {
+                admitted_ = false;
+                server_.release_connection(client_ip_);
+            }
+        }
+
+        // Thời điểm kết nối bị coi là treo nếu không nhận thêm dữ liệu: read timeout khi chưa nhận byte nào
+        // hoặc một khung đang dở, idle timeout khi đang chờ giữa hai khung. time_point::max() nếu không giới hạn
+        // (kể cả khi đang tạm ngừng đọc vì backpressure).
+        std::chrono::steady_clock::time_point read_deadline() const {
+            bool mid_frame = !received_any_ || frames_.has_partial_frame();
+            unsigned int seconds = mid_frame ? server_.config_.read_timeout_seconds : server_.config_.idle_timeout_seconds;
+            if (seconds == 0 || throttled_) {
+                return std::chrono::steady_clock::time_point::max();
+            }
+            return last_activity_ + std::chrono::seconds(seconds);
+        }
+
+        // Xử lý dữ liệu vừa nhận: mỗi lần đọc có thể chứa nhiều bản ghi hoặc chỉ một phần bản ghi.
+        // Trả về false nếu luồng dữ liệu hỏng và kết nối phải đóng.
+        bool consume(const char* data, std::size_t len) {
+            received_any_ = true;
+            last_activity_ = std::chrono::steady_clock::now();
+            frames_.append(data, len);
+            while (auto frame = frames_.next()) {
+                if (frames_.framing() == FrameReader::Framing::Binary) {
+                    handle_binary_frame(*frame);
+                } else {
+                    handle_text_frame(*frame);
+                }
+            }
+
+            if (frames_.corrupted()) {
+                std::cerr << "Malformed stream from " << client_ip_ << ", closing connection." << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        // Đối phương đã đóng chiều gửi. Kết nối chưa đóng ngay: gateway thường gửi, shutdown(SHUT_WR) rồi mới
+        // đọc các ACK, nên close_after_replies() chỉ được gọi khi mọi phản hồi đang chờ đã vào hàng gửi.
+        void consume_eof() {
+            // Firmware cũ gửi một bản ghi không có '\n' rồi đóng chiều gửi.
+            if (auto rest = frames_.take_remainder()) {
+                handle_text_frame(*rest);
+            }
+            close_when_settled_ = true;
+            settle();
+        }
+
+        // Gửi phản hồi cho thiết bị; chỉ được gọi trên luồng (strand) của kết nối.
+        virtual void send_reply(std::string reply) = 0;
+
+        // Bọc fn để nó chạy lại trên luồng (strand) của kết nối khi luồng xử lý báo đã ghi xong.
+        virtual std::function<void(std::size_t)> on_connection_thread(std::function<void(Session&, std::size_t)> fn) = 0;
+
+        // Chạy fn trên luồng (strand) của kết nối, sau các handler đang chờ ở đó.
+        virtual void defer(std::function<void(Session&)> fn) = 0;
+
+        // Sau EOF, không còn phản hồi nào đang chờ: đóng kết nối khi hàng gửi đã trống.
+        virtual void close_after_replies() = 0;
+
+        LoRaServer& server_;
+        std::string client_ip_;
+        bool throttled_ = false; // Hàng đợi báo quá tải: ngừng đọc sau khi xử lý xong bộ đệm hiện tại.
+
+    private:
+        // Đưa bản ghi vào hàng đợi nhập liệu. on_stored (nếu có) chạy lại trên luồng của kết nối sau khi đã ghi.
+        // Bản ghi có số thứ tự được xác nhận bằng ACK/NAK thay cho on_stored.
+        void submit(std::vector<DeviceReading> readings, std::optional<std::uint64_t> sequence,
+                    std::function<void(Session&, std::size_t)> on_stored) {
+            if (sequence) {
+                on_stored = [seq = *sequence, count = readings.size()](Session& session, std::size_t stored) {
+                    session.acknowledge(seq, stored == count);
+                };
+            }
+
+            IngestItem item{client_ip_, std::move(readings), {}};
+            bool awaits_reply = static_cast<bool>(on_stored);
+            if (on_stored) {
+                item.on_stored = awaited_reply(std::move(on_stored));
+            }
+
+            switch (server_.ingest_queue_.push(item)) {
+                case IngestQueue<IngestItem>::Admission::Accepted:
+                    awaiting_replies_ += awaits_reply;
+                    break;
+                case IngestQueue<IngestItem>::Admission::AcceptedThrottle:
+                    awaiting_replies_ += awaits_reply;
+                    throttled_ = true;
+                    break;
+                case IngestQueue<IngestItem>::Admission::Shed:
+                    if (sequence) {
+                        acknowledge(*sequence, false); // Một ACK sau này không được phép che bản ghi đã bị bỏ.
+                    } else if (server_.ingest_queue_.policy() == OverloadPolicy::Reject) {
+                        send_reply("ERR BUSY\n");
+                    }
+                    break;
+            }
+        }
+
+        // Ghi nhận kết quả của một bản ghi có số thứ tự. Xác nhận được gộp lại và gửi trong một lần ghi,
+        // sau khi các handler đang chờ của kết nối (thường là các lần ghi xong khác) đã chạy.
+        void acknowledge(std::uint64_t sequence, bool stored) {
+            if (stored) {
+                durable_sequence_ = std::max(durable_sequence_.value_or(0), sequence);
+            } else {
+                pending_naks_ += "NAK " + std::to_string(sequence) + "\n";
+            }
+
+            if (!ack_flush_scheduled_) {
+                ack_flush_scheduled_ = true;
+                defer([](Session& session) { session.flush_acknowledgments(); });
+            }
+        }
+
+        // "ACK n" xác nhận mọi số thứ tự <= n đã được ghi bền vững, trừ các số đã báo "NAK".
+        void flush_acknowledgments() {
+            ack_flush_scheduled_ = false;
+
+            std::string reply = std::move(pending_naks_);
+            pending_naks_.clear();
+            if (durable_sequence_ && durable_sequence_ != acked_sequence_) {
+                reply += "ACK " + std::to_string(*durable_sequence_) + "\n";
+                acked_sequence_ = durable_sequence_;
+            }
+            if (!reply.empty()) {
+                send_reply(std::move(reply));
+            }
+            settle();
+        }
+
+        // Như on_connection_thread, và fn được tính là một phản hồi đang chờ cho tới khi chạy xong. Người gọi
+        // tăng awaiting_replies_ khi chắc chắn callback sẽ được gọi; callback chạy trên cùng strand nên không
+        // thể chạy trước lúc đó.
+        std::function<void(std::size_t)> awaited_reply(std::function<void(Session&, std::size_t)> fn) {
+            return on_connection_thread([fn = std::move(fn)](Session& session, std::size_t stored) {
+                --session.awaiting_replies_;
+                fn(session, stored);
+                session.settle();
+            });
+        }
+
+        // Đóng kết nối đã nhận EOF khi không còn ACK hay phản hồi truy vấn nào phải gửi.
+        void settle() {
+            if (close_when_settled_ && awaiting_replies_ == 0 && !ack_flush_scheduled_) {
+                close_when_settled_ = false;
+                close_after_replies();
+            }
+        }
+
+        void handle_text_frame(std::string_view frame) {
+            if (frame.substr(0, kQueryPrefix.size()) == kQueryPrefix) {
+                handle_query(frame);
+                return;
+            }
+            std::optional<std::uint64_t> sequence = take_sequence(frame);
+            std::vector<DeviceReading> readings;
+            RequestResult result = server_.handle_request(client_ip_, frame, readings);
+            if (readings.empty()) {
+                if (sequence) {
+                    acknowledge(*sequence, false);
+                } else if (result.batch) {
+                    send_reply(batch_acknowledgment(0, result.rejected));
+                }
+                return;
+            }
+
+            if (!result.batch) {
+                submit(std::move(readings), sequence, nullptr);
+                return;
+            }
+
+            std::size_t total = result.accepted + result.rejected;
+            submit(std::move(readings), sequence, [total](Session& session, std::size_t stored) {
+                session.send_reply(batch_acknowledgment(stored, total));
+            });
+        }
+
+        // Truy vấn chạy trên nhóm luồng truy vấn; phản hồi được gửi lại trên luồng của kết nối.
+        void handle_query(std::string_view request) {
+            auto reply = std::make_shared<std::string>();
+            auto deliver = awaited_reply([reply](Session& session, std::size_t) {
+                session.send_reply(std::move(*reply));
+            });
+            bool queued = server_.submit_query(std::string(request), [reply, deliver](std::string result) {
+                *reply = std::move(result);
+                deliver(0);
+            });
+            if (queued) {
+                ++awaiting_replies_;
+            } else {
+                send_reply("ERR BUSY\n");
+            }
+        }
+
+        // Giải mã khung nhị phân thẳng vào SensorData, không qua chuỗi trung gian.
+        void handle_binary_frame(std::string_view frame) {
+            std::optional<std::uint64_t> sequence;
+            std::uint32_t wire_sequence;
+            if (WireProtocol::unwrap_sequence(frame, wire_sequence)) {
+                sequence = wire_sequence;
+            }
+
+            if (WireProtocol::is_batch(frame)) {
+                if (!WireProtocol::decode_batch(frame, decoded_batch_)) {
+                    std::cerr << "Error decoding binary batch from " << client_ip_ << "." << std::endl;
+                    if (sequence) {
+                        acknowledge(*sequence, false);
+                    }
+                    return;
+                }
+
+                // Cả lô được xử lý với một lần khóa và một giao dịch, rồi xác nhận một lần. Bản ghi không qua
+                // kiểm tra bị bỏ và không được tính vào "ACK BATCH", như lô văn bản.
+                std::vector<DeviceReading> batch;
+                batch.reserve(decoded_batch_.size());
+                ReadingParser::Result first_error; // Lỗi kiểm tra đầu tiên, để in một dòng cho cả lô.
+                std::string device_id;
+                for (const WireProtocol::BinaryReading& reading : decoded_batch_) {
+                    if (!resolve_device_id(reading, device_id)) {
+                        continue;
+                    }
+                    DeviceReading device_reading;
+                    ReadingParser::Result checked = make_binary_reading(device_id, reading, device_reading);
+                    if (checked) {
+                        batch.push_back(std::move(device_reading));
+                    } else if (first_error) {
+                        first_error = checked;
+                    }
+                }
+                if (!first_error) {
+                    std::cerr << "Error in binary batch from " << client_ip_
+                              << " (first: " << describe_parse_error(first_error) << ")." << std::endl;
+                }
+                std::size_t total = decoded_batch_.size();
+                if (batch.empty()) {
+                    if (sequence) {
+                        acknowledge(*sequence, false);
+                    } else {
+                        send_reply(batch_acknowledgment(0, total));
+                    }
+                    return;
+                }
+                submit(std::move(batch), sequence, [total](Session& session, std::size_t stored) {
+                    session.send_reply(batch_acknowledgment(stored, total));
+                });
+                return;
+            }
+
+            WireProtocol::BinaryReading reading;
+            std::vector<DeviceReading> readings(1);
+            std::string device_id;
+            if (!WireProtocol::decode_binary_reading(frame, reading)) {
+                std::cerr << "Error decoding binary frame from " << client_ip_ << "." << std::endl;
+                readings.clear();
+            } else if (!resolve_device_id(reading, device_id)) {
+                readings.clear();
+            } else if (ReadingParser::Result checked = make_binary_reading(device_id, reading, readings.front()); !checked) {
+                std::cerr << "Error in binary reading from " << client_ip_ << ": " << describe_parse_error(checked) << "." << std::endl;
+                readings.clear();
+            }
+            if (readings.empty()) {
+                if (sequence) {
+                    acknowledge(*sequence, false);
+                }
+                return;
+            }
+            submit(std::move(readings), sequence, nullptr);
+        }
+
+        // Xác định ID thiết bị của một khung, ghi nhớ hoặc tra cứu slot đã gán trên kết nối này.
+        bool resolve_device_id(const WireProtocol::BinaryReading& reading, std::string& device_id) {
+            if (reading.references_slot) {
+                // ID đã được gán cho slot bằng một khung trước đó trên cùng kết nối.
+                if (reading.slot >= interned_ids_.size() || interned_ids_[reading.slot].empty()) {
+                    std::cerr << "Unknown device slot " << reading.slot << " from " << client_ip_ << "." << std::endl;
+                    return false;
+                }
+                device_id = interned_ids_[reading.slot];
+                return true;
+            }
+
+            device_id.assign(reading.device_id);
+            if (reading.defines_slot) {
+                if (reading.slot >= interned_ids_.size()) {
+                    interned_ids_.resize(reading.slot + 1);
+                }
+                interned_ids_[reading.slot] = device_id;
+            }
+            return true;
+        }
+
+        FrameReader frames_;
+        std::vector<std::string> interned_ids_; // ID thiết bị theo slot, chỉ dùng cho khung nhị phân.
+        std::vector<WireProtocol::BinaryReading> decoded_batch_; // Tái sử dụng giữa các khung lô.
+
+        std::optional<std::uint64_t> durable_sequence_; // Số thứ tự lớn nhất đã được ghi bền vững.
+        std::optional<std::uint64_t> acked_sequence_; // Số thứ tự trong lần "ACK" gần nhất đã gửi.
+        std::string pending_naks_; // Các dòng "NAK" chờ gửi cùng lần ghi tiếp theo.
+        bool ack_flush_scheduled_ = false;
+        std::size_t awaiting_replies_ = 0; // Lô chờ ghi và truy vấn chờ chạy mà kết nối còn phải trả lời.
+        bool close_when_settled_ = false; // Đã nhận EOF; đóng khi awaiting_replies_ về 0.
+
+        std::chrono::steady_clock::time_point last_activity_; // Lần cuối nhận được dữ liệu (hoặc lúc accept).
+        bool received_any_ = false;
+        bool admitted_ = false; // Đang giữ một chỗ trong giới hạn kết nối theo IP.
+    };
+
+    // Một kết nối Asio từ thiết bị. Đối tượng sống nhờ shared_ptr được giữ bởi các handler bất đồng bộ
+    // và tự giải phóng khi không còn thao tác nào đang chờ.
+    class Connection : public Session, public std::enable_shared_from_this<Connection> {
+    public:
+        Connection(LoRaServer& server, tcp::socket socket)
+                : Session(server),
+                  socket_(std::move(socket)),
+                  throttle_timer_(socket_.get_executor()),
+                  deadline_timer_(socket_.get_executor()) {}
+
+        void start() {
+            boost::system::error_code error;
+            tcp::endpoint remote_endpoint = socket_.remote_endpoint(error); // Xác định địa chỉ IP của thiết bị gửi dữ liệu.
+            if (error) {
+                return; // Thiết bị đã ngắt kết nối trước khi ta kịp đọc.
+            }
+            client_ip_ = remote_endpoint.address().to_string();
+
+            if (!admit()) {
+                close(); // IP này đã có quá nhiều kết nối đang mở.
+                return;
+            }
+
+            do_read();
+            check_deadline();
+        }
+
+    protected:
+        // Phản hồi xếp vào outbox_ và được gửi lần lượt bằng async_write: phản hồi dài (QUERY READINGS) được gửi
+        // trọn vẹn mà không chặn strand của kết nối.
+        void send_reply(std::string reply) override {
+            if (!socket_.is_open()) {
+                return;
+            }
+            outbox_.push_back(std::move(reply));
+            if (outbox_.size() == 1) {
+                do_write();
+            }
+        }
+
+        std::function<void(std::size_t)> on_connection_thread(std::function<void(Session&, std::size_t)> fn) override {
+            auto self = shared_from_this();
+            return [self, fn = std::move(fn)](std::size_t stored) {
+                boost::asio::post(self->socket_.get_executor(), [self, fn, stored]() { fn(*self, stored); });
+            };
+        }
+
+        void defer(std::function<void(Session&)> fn) override {
+            auto self = shared_from_this();
+            boost::asio::post(socket_.get_executor(), [self, fn = std::move(fn)]() { fn(*self); });
+        }
+
+        void close_after_replies() override {
+            if (outbox_.empty()) {
+                close();
+            } else {
+                close_after_send_ = true; // do_write() đóng khi outbox_ trống.
+            }
+        }
+
+    private:
+        // Gửi phần tử đầu của outbox_; async_write tự gửi tiếp phần còn lại khi socket chỉ nhận một phần.
+        void do_write() {
+            auto self = shared_from_this();
+            boost::asio::async_write(socket_, boost::asio::buffer(outbox_.front()),
+                                     [this, self](const boost::system::error_code& error, size_t) {
+                                         if (error) {
+                                             close();
+                                             return;
+                                         }
+                                         outbox_.pop_front();
+                                         if (!outbox_.empty()) {
+                                             do_write();
+                                         } else if (close_after_send_) {
+                                             close();
+                                         }
+                                     });
+        }
+
+        // Kết nối được giữ mở lâu dài cho tới khi thiết bị đóng nó.
+        void do_read() {
+            auto self = shared_from_this();
+            socket_.async_read_some(boost::asio::buffer(buffer_),
+                                    [this, self](const boost::system::error_code& error, size_t len) {
+                                        if (error) {
+                                            if (error == boost::asio::error::eof) {
+                                                consume_eof(); // Thiết bị chỉ đóng chiều gửi: đóng sau khi gửi nốt phản hồi.
+                                                return;
+                                            }
+                                            close();
+                                            return;
+                                        }
+
+                                        if (!consume(buffer_.data(), len)) {
+                                            close();
+                                            return;
+                                        }
+
+                                        if (throttled_) {
+                                            wait_for_queue(); // Hàng đợi quá tải: tạm ngừng đọc.
+                                        } else {
+                                            do_read(); // Tiếp tục đọc trên cùng kết nối.
+                                        }
+                                    });
+        }
+
+        // Backpressure: chờ hàng đợi nhập liệu xuống dưới ngưỡng thấp rồi mới đọc tiếp, để TCP tự làm chậm thiết bị.
+        void wait_for_queue() {
+            if (!server_.ingest_queue_.overloaded()) {
+                throttled_ = false;
+                do_read();
+                return;
+            }
+
+            auto self = shared_from_this();
+            throttle_timer_.expires_after(std::chrono::milliseconds(10));
+            throttle_timer_.async_wait([this, self](const boost::system::error_code& error) {
+                if (!error) {
+                    wait_for_queue();
+                }
+            });
+        }
+
+        // Đóng kết nối khi quá hạn đọc, để thiết bị kết nối rồi im lặng không giữ socket mãi mãi.
+        void check_deadline() {
+            if (!socket_.is_open()) {
+                return;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            auto deadline = read_deadline();
+            if (deadline <= now) {
+                server_.reaped_connections_.fetch_add(1, std::memory_order_relaxed);
+                close();
+                return;
+            }
+
+            // Không giới hạn (hết hạn bị tắt hoặc đang backpressure): kiểm tra lại sau một giây.
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                if (server_.config_.read_timeout_seconds == 0 && server_.config_.idle_timeout_seconds == 0) {
+                    return;
+                }
+                deadline = now + std::chrono::seconds(1);
+            }
+
+            auto self = shared_from_this();
+            deadline_timer_.expires_at(deadline);
+            deadline_timer_.async_wait([this, self](const boost::system::error_code& error) {
+                if (!error) {
+                    check_deadline(); // Hạn có thể đã dời vì có dữ liệu mới; kiểm tra lại.
+                }
+            });
+        }
+
+        void close() {
+            boost::system::error_code ignored;
+            socket_.shutdown(tcp::socket::shutdown_both, ignored);
+            socket_.close(ignored);
+            throttle_timer_.cancel();
+            deadline_timer_.cancel();
+            release();
+        }
+
+        tcp::socket socket_;
+        std::array<char, 1024> buffer_{};
+        std::deque<std::string> outbox_; // Phần tử đầu đang được async_write gửi; deque giữ nguyên địa chỉ khi thêm vào cuối.
+        bool close_after_send_ = false; // Không còn phản hồi nào sắp tới; đóng khi outbox_ rỗng.
+        steady_timer throttle_timer_; // Hẹn giờ kiểm tra lại hàng đợi khi đang bị backpressure.
+        steady_timer deadline_timer_; // Hẹn giờ đóng kết nối quá hạn đọc.
+    };
+
+#ifdef LORA_WITH_IO_URING
+    // Một kết nối do vòng io_uring phục vụ; mọi hàm chạy trên luồng của vòng đó.
+    class UringConnection : public Session,
+                            public UringEventLoop::Handler,
+                            public std::enable_shared_from_this<UringConnection> {
+    public:
+        UringConnection(LoRaServer& server, UringEventLoop& loop, UringEventLoop::ConnectionId id, std::string client_ip)
+                : Session(server), loop_(loop), id_(id) {
+            client_ip_ = std::move(client_ip);
+        }
+
+        // Giữ một chỗ trong giới hạn kết nối theo IP; false thì vòng đóng socket ngay.
+        bool start() {
+            return admit();
+        }
+
+        bool on_data(const char* data, std::size_t len) override {
+            return consume(data, len);
+        }
+
+        void on_eof() override {
+            consume_eof();
+        }
+
+        std::chrono::steady_clock::time_point deadline() override {
+            return read_deadline();
+        }
+
+        void on_close(bool expired) override {
+            if (expired) {
+                server_.reaped_connections_.fetch_add(1, std::memory_order_relaxed);
+            }
+            release();
+        }
+
+        // Backpressure: ngừng đọc cho tới khi hàng đợi nhập liệu xuống dưới ngưỡng thấp.
+        bool paused() override {
+            if (throttled_ && !server_.ingest_queue_.overloaded()) {
+                throttled_ = false;
+            }
+            return throttled_;
+        }
+
+    protected:
+        void send_reply(std::string reply) override {
+            loop_.send(id_, std::move(reply));
+        }
+
+        std::function<void(std::size_t)> on_connection_thread(std::function<void(Session&, std::size_t)> fn) override {
+            auto self = shared_from_this();
+            return [self, fn = std::move(fn)](std::size_t stored) {
+                self->loop_.post([self, fn, stored]() { fn(*self, stored); });
+            };
+        }
+
+        void defer(std::function<void(Session&)> fn) override {
+            auto self = shared_from_this();
+            loop_.post([self, fn = std::move(fn)]() { fn(*self); });
+        }
+
+        void close_after_replies() override {
+            loop_.close_after_send(id_);
+        }
+
+    private:
+        UringEventLoop& loop_;
+        UringEventLoop::ConnectionId id_;
+    };
+#endif
+
+    // Kết quả xử lý một bản ghi văn bản (đơn hoặc lô).
+    struct RequestResult {
+        bool batch = false; // Bản ghi là một lô "BATCH ...".
+        std::size_t accepted = 0; // Số bản ghi đã được xử lý.
+        std::size_t rejected = 0; // Số bản ghi sai định dạng.
+    };
+
+    static constexpr std::string_view kBatchPrefix = "BATCH "; // Tiền tố của một lô văn bản.
+    static constexpr std::string_view kQueryPrefix = "QUERY "; // Tiền tố của một yêu cầu truy vấn.
+    static constexpr std::size_t kMaxQueryRows = 10000; // Số hàng tối đa trong một phản hồi "QUERY READINGS".
+    static constexpr std::size_t kMaxPendingQueries = 1024; // Truy vấn chờ vượt mức này nhận "ERR BUSY".
+
+    static constexpr const char* kQueryControlSql =
+            "SELECT command, timestamp FROM user_control WHERE device_id = ? ORDER BY timestamp DESC LIMIT 1";
+
+    // Tách số thứ tự tùy chọn "#<n> " ở đầu một bản ghi văn bản (đơn hoặc lô) và bỏ nó khỏi frame.
+    static std::optional<std::uint64_t> take_sequence(std::string_view& frame) {
+        if (frame.empty() || frame.front() != '#') {
+            return std::nullopt;
+        }
+        std::uint64_t sequence = 0;
+        auto [end, ec] = std::from_chars(frame.data() + 1, frame.data() + frame.size(), sequence);
+        if (ec != std::errc() || end == frame.data() + 1 || end == frame.data() + frame.size() || *end != ' ') {
+            return std::nullopt;
+        }
+        frame.remove_prefix(static_cast<std::size_t>(end - frame.data()) + 1);
+        return sequence;
+    }
+
+    // Một shard accept: io_context riêng (gợi ý đồng thời = 1 vì chỉ một luồng chạy nó) và acceptor riêng.
+    struct AcceptorShard {
+        io_context context{1};
+        tcp::acceptor acceptor{context};
+    };
+
+    ServerConfig config_; // Cấu hình khởi động.
     io_service io_service_; // Đối tượng io_service cho việc quản lý I/O bất đồng bộ.
     tcp::acceptor acceptor_; // Đối tượng acceptor cho việc chấp nhận kết nối từ client.
-    std::map<std::string, DeviceData> lora_devices; // Map lưu trữ thông tin thiết bị LoRa.
-    std::mutex devices_mutex; // Mutex để đồng bộ hóa truy cập đối tượng thiết bị.
+    std::vector<std::unique_ptr<AcceptorShard>> shards_; // Các shard SO_REUSEPORT, rỗng nếu không bật.
+    DeviceRegistry<DeviceData> lora_devices; // Thông tin thiết bị LoRa, mỗi shard một khóa.
+
+    // Bộ đếm theo từng nguồn gửi UDP.
+    struct UdpSourceCounters {
+        unsigned long long received = 0; // Datagram nhận được.
+        unsigned long long malformed = 0; // Datagram không phân tích được.
+        unsigned long long dropped = 0; // Datagram bị cắt cụt vì lớn hơn bộ đệm nên bị bỏ.
+    };
+
+    static constexpr std::size_t kUdpBatchSize = 64; // Số datagram tối đa trong một lần recvmmsg().
+    static constexpr std::size_t kMaxDatagramSize = 2048;
+    static constexpr std::size_t kMaxUdpSources = 4096; // Nguồn vượt giới hạn được gộp vào một dòng chung.
+
+    // Bộ đệm nhận theo lô. Chỉ có một thao tác chờ đọc UDP tại một thời điểm nên không cần khóa.
+    struct UdpReceiveBatch {
+        std::array<std::array<char, kMaxDatagramSize>, kUdpBatchSize> payloads{};
+#ifdef __linux__
+        std::array<mmsghdr, kUdpBatchSize> headers{};
+        std::array<iovec, kUdpBatchSize> iovecs{};
+        std::array<sockaddr_storage, kUdpBatchSize> addresses{};
+        std::array<std::array<char, CMSG_SPACE(sizeof(std::uint32_t))>, kUdpBatchSize> controls{};
+#else
+        udp::endpoint sender;
+#endif
+    };
+
+    udp::socket udp_socket_; // Socket UDP, chỉ được mở khi config_.udp_port khác 0.
+    std::unique_ptr<UdpReceiveBatch> udp_batch_;
+    std::map<ip::address, UdpSourceCounters> udp_sources_; // Bộ đếm theo địa chỉ nguồn.
+    UdpSourceCounters udp_other_sources_; // Bộ đếm cho các nguồn vượt quá kMaxUdpSources.
+    std::uint32_t udp_kernel_drops_ = 0; // Số datagram nhân hệ điều hành bỏ vì hàng đợi socket đầy (SO_RXQ_OVFL).
+    std::mutex udp_stats_mutex_;
+
+    steady_timer metrics_timer_; // Bộ định thời in số liệu thống kê.
+    IngestQueue<IngestItem> ingest_queue_; // Hàng đợi nhập liệu có giới hạn, nhiều luồng ghi - một luồng đọc.
+    std::unique_ptr<StorageBackend> storage_; // Nơi lưu bản ghi cảm biến; mở trong start(), luồng xử lý ghi, luồng truy vấn đọc qua query_range().
+    std::unique_ptr<SqliteReadPool> read_pool_; // Kết nối chỉ đọc của các luồng truy vấn; nullptr nếu tắt truy vấn.
+    std::unique_ptr<boost::asio::thread_pool> query_threads_; // Chạy "QUERY ..." ngoài luồng mạng và luồng xử lý.
+    std::atomic<std::size_t> pending_queries_{0}; // Truy vấn đã nhận nhưng chưa chạy xong.
+    std::atomic<std::uint64_t> queries_{0}; // Số truy vấn đã chạy.
+    std::atomic<std::uint64_t> rejected_queries_{0}; // Số truy vấn bị từ chối vì quá nhiều truy vấn chờ.
+    std::atomic<std::uint64_t> commits_{0}; // Số giao dịch group commit.
+    std::atomic<std::uint64_t> committed_rows_{0}; // Số bản ghi đã đưa vào các giao dịch đó.
+
+    std::mutex connections_mutex_;
+    std::unordered_map<std::string, std::size_t> connections_per_ip_; // Số kết nối TCP đang mở theo IP.
+    std::atomic<std::size_t> open_connections_{0}; // Số socket TCP đang mở.
+    std::atomic<std::uint64_t> reaped_connections_{0}; // Số kết nối bị đóng vì quá hạn đọc.
+    std::atomic<std::uint64_t> rejected_connections_{0}; // Số kết nối bị từ chối vì vượt giới hạn theo IP.
+
+    bool admit_connection(const std::string& client_ip) {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        std::size_t& count = connections_per_ip_[client_ip];
+        if (config_.max_connections_per_ip != 0 && count >= config_.max_connections_per_ip) {
+            if (count == 0) {
+                connections_per_ip_.erase(client_ip);
+            }
+            rejected_connections_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        ++count;
+        open_connections_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void release_connection(const std::string& client_ip) {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto it = connections_per_ip_.find(client_ip);
+        if (it != connections_per_ip_.end() && --it->second == 0) {
+            connections_per_ip_.erase(it);
+        }
+        open_connections_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+#ifdef LORA_WITH_IO_URING
+    std::vector<std::unique_ptr<UringEventLoop>> uring_loops_; // Mỗi vòng một luồng, rỗng nếu dùng Asio.
+    std::unique_ptr<UringFileAppender> uring_log_; // Ghi log.txt qua io_uring; chỉ luồng xử lý dùng.
+#endif
+
+    // Phục vụ kết nối TCP bằng io_uring nếu được cấu hình. Trả về false để dùng đường Asio.
+    bool start_uring([[maybe_unused]] std::vector<std::thread>& workers) {
+        if (config_.io_backend != IoBackend::Uring) {
+            return false;
+        }
+#ifdef LORA_WITH_IO_URING
+        try {
+            uring_log_ = std::make_unique<UringFileAppender>("log.txt");
+            for (std::size_t i = 0; i < config_.worker_threads; ++i) {
+                auto factory = [this](UringEventLoop& loop, UringEventLoop::ConnectionId id, std::string client_ip)
+                        -> std::shared_ptr<UringEventLoop::Handler> {
+                    auto connection = std::make_shared<UringConnection>(*this, loop, id, std::move(client_ip));
+                    return connection->start() ? connection : nullptr;
+                };
+                uring_loops_.push_back(
+                        std::make_unique<UringEventLoop>(config_.server_ip, config_.server_port, factory));
+            }
+        } catch (const std::system_error& error) {
+            // Ví dụ nhân cũ hoặc io_uring bị chặn bởi seccomp trong container.
+            std::cerr << "io_uring unavailable (" << error.what() << "), falling back to Asio." << std::endl;
+            uring_loops_.clear();
+            uring_log_.reset();
+            return false;
+        }
+
+        for (auto& loop : uring_loops_) {
+            workers.emplace_back([&loop]() { loop->run(); });
+        }
+        return true;
+#else
+        std::cerr << "Built without io_uring support (ENABLE_IO_URING), falling back to Asio." << std::endl;
+        return false;
+#endif
+    }
+
+    // Mỗi socket được chấp nhận có strand riêng trên io_context của acceptor, nên kết nối ở lại trên shard
+    // nhận nó và các handler của nó (kể cả phản hồi được gửi từ luồng xử lý) không bao giờ chạy song song.
+    void do_accept(tcp::acceptor& acceptor) {
+        acceptor.async_accept(make_strand(acceptor.get_executor()),
+                              [this, &acceptor](const boost::system::error_code& error, tcp::socket socket) {
+                                  if (!error) {
+                                      std::make_shared<Connection>(*this, std::move(socket))->start();
+                                  } else {
+                                      std::cerr << "Accept error: " << error.message() << std::endl;
+                                  }
+
+                                  do_accept(acceptor); // Tiếp tục chấp nhận kết nối tiếp theo.
+                              });
+    }
 
-    static void create_sensor_data_table() {
-        sqlite3 *db; // Con trỏ đối tượng cơ sở dữ liệu SQLite.
-        int rc = sqlite3_open("lora.db", &db); // Mở hoặc tạo cơ sở dữ liệu "lora.db".
+    void open_acceptor(tcp::acceptor& acceptor, bool reuse_port) {
+        tcp::endpoint endpoint(ip::address::from_string(config_.server_ip), config_.server_port);
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+        if (reuse_port) {
+            acceptor.set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+        }
+#endif
+        acceptor.bind(endpoint);
+        acceptor.listen(socket_base::max_listen_connections);
+    }
+
+    static constexpr bool reuse_port_supported() {
+#ifdef SO_REUSEPORT
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Gắn luồng của shard vào một lõi để bộ nhớ đệm và hàng đợi socket của nó không di chuyển giữa các lõi.
+    static void pin_to_core(std::thread& thread, std::size_t index) {
+#ifdef __linux__
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % cores, &cpus);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#else
+        (void) thread;
+        (void) index;
+#endif
+    }
 
-        if (rc) {
-            std::cerr << "Không thể mở cơ sở dữ liệu: " << sqlite3_errmsg(db) << std::endl; // In lỗi nếu không thể mở cơ sở dữ liệu.
-            sqlite3_close(db);
+    void start_udp() {
+        if (config_.udp_port == 0) {
             return;
         }
 
-        std::string create_table_query = "CREATE TABLE IF NOT EXISTS sensor_data ("
-                                         "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                                         "device_id TEXT, "
-                                         "light_intensity REAL, "
-                                         "temperature REAL, "
-                                         "air_humidity REAL, "
-                                         "soil_humidity REAL, "
-                                         "prediction TEXT, "
-                                         "timestamp TEXT, "
-                                         "note TEXT"
-                                         ");";
+        udp::endpoint endpoint(ip::address::from_string(config_.server_ip), config_.udp_port);
+        udp_socket_.open(endpoint.protocol());
+        udp_socket_.set_option(socket_base::receive_buffer_size(4 * 1024 * 1024)); // Chịu được đợt gửi dồn dập.
+        udp_socket_.bind(endpoint);
+        udp_socket_.non_blocking(true);
+        udp_batch_ = std::make_unique<UdpReceiveBatch>();
+
+#ifdef __linux__
+        int enable = 1;
+        setsockopt(udp_socket_.native_handle(), SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+#endif
+
+        do_receive_udp();
+    }
+
+#ifdef __linux__
+    // Chờ socket có dữ liệu rồi rút cạn hàng đợi bằng recvmmsg(), mỗi lời gọi nhận tối đa kUdpBatchSize datagram.
+    void do_receive_udp() {
+        udp_socket_.async_wait(udp::socket::wait_read, [this](const boost::system::error_code& error) {
+            if (error) {
+                if (error != boost::asio::error::operation_aborted) {
+                    std::cerr << "UDP wait error: " << error.message() << std::endl;
+                }
+                return;
+            }
+
+            receive_udp_batches();
+            do_receive_udp();
+        });
+    }
+
+    void receive_udp_batches() {
+        UdpReceiveBatch& batch = *udp_batch_;
+
+        while (true) {
+            for (std::size_t i = 0; i < kUdpBatchSize; ++i) {
+                batch.iovecs[i] = {batch.payloads[i].data(), kMaxDatagramSize};
+                msghdr& header = batch.headers[i].msg_hdr;
+                header = {};
+                header.msg_name = &batch.addresses[i];
+                header.msg_namelen = sizeof(sockaddr_storage);
+                header.msg_iov = &batch.iovecs[i];
+                header.msg_iovlen = 1;
+                header.msg_control = batch.controls[i].data();
+                header.msg_controllen = batch.controls[i].size();
+            }
+
+            int received = recvmmsg(udp_socket_.native_handle(), batch.headers.data(), kUdpBatchSize, MSG_DONTWAIT, nullptr);
+            if (received <= 0) {
+                return; // EAGAIN: hàng đợi đã rỗng.
+            }
+
+            for (int i = 0; i < received; ++i) {
+                const msghdr& header = batch.headers[i].msg_hdr;
+
+                udp::endpoint sender;
+                std::memcpy(sender.data(), &batch.addresses[i], header.msg_namelen);
+                sender.resize(header.msg_namelen);
+
+                for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+                     cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                        std::lock_guard<std::mutex> lock(udp_stats_mutex_);
+                        std::memcpy(&udp_kernel_drops_, CMSG_DATA(cmsg), sizeof(udp_kernel_drops_));
+                    }
+                }
 
-        // Thêm tạo bảng user_control
-        create_table_query += "CREATE TABLE IF NOT EXISTS user_control ("
-                              "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                              "device_id TEXT, "
-                              "command TEXT, "
-                              "timestamp TEXT"
-                              ");";
+                bool truncated = header.msg_flags & MSG_TRUNC;
+                handle_datagram(sender.address(), batch.payloads[i].data(), batch.headers[i].msg_len, truncated);
+            }
 
-        char *errmsg; // Con trỏ chuỗi cho thông báo lỗi từ SQLite.
-        rc = sqlite3_exec(db, create_table_query.c_str(), nullptr, nullptr, &errmsg); // Thực hiện câu lệnh tạo bảng.
+            if (static_cast<std::size_t>(received) < kUdpBatchSize) {
+                return;
+            }
+        }
+    }
+#else
+    // Trên nền tảng không có recvmmsg(), nhận từng datagram một.
+    void do_receive_udp() {
+        UdpReceiveBatch& batch = *udp_batch_;
+        udp_socket_.async_receive_from(boost::asio::buffer(batch.payloads[0]), batch.sender,
+                                       [this](const boost::system::error_code& error, size_t len) {
+                                           if (error == boost::asio::error::operation_aborted) {
+                                               return;
+                                           }
+                                           bool truncated = error == boost::asio::error::message_size;
+                                           if (!error || truncated) {
+                                               handle_datagram(udp_batch_->sender.address(), udp_batch_->payloads[0].data(), len, truncated);
+                                           }
+                                           do_receive_udp();
+                                       });
+    }
+#endif
+
+    // Một datagram chứa một hoặc nhiều bản ghi văn bản (ngăn cách bởi '\n') hoặc các khung nhị phân.
+    // Khung nhị phân qua UDP phải mang ID đầy đủ vì không có trạng thái kết nối để tra slot.
+    void handle_datagram(const ip::address& source, const char* data, std::size_t len, bool truncated) {
+        bool malformed = false;
+        bool shed = false; // Hàng đợi quá tải; UDP không thể backpressure nên datagram bị bỏ.
+
+        if (!truncated) {
+            std::string_view payload(data, len);
+            const std::string client_ip = source.to_string();
+
+            if (!payload.empty() && WireProtocol::is_binary_magic(static_cast<unsigned char>(payload.front()))) {
+                std::vector<WireProtocol::BinaryReading> readings;
+                while (!payload.empty() && !malformed) {
+                    std::size_t frame_len = WireProtocol::binary_frame_size(payload);
+                    if (frame_len == WireProtocol::kNeedMoreData || frame_len == WireProtocol::kInvalidFrame) {
+                        malformed = true;
+                        break;
+                    }
 
-        if (rc != SQLITE_OK) {
-            std::cerr << "Lỗi SQL: " << errmsg << std::endl; // In thông báo lỗi nếu có lỗi SQL.
-            sqlite3_free(errmsg);
+                    std::string_view frame = payload.substr(0, frame_len);
+                    readings.resize(1);
+                    if (WireProtocol::is_batch(frame) ? !WireProtocol::decode_batch(frame, readings)
+                                                      : !WireProtocol::decode_binary_reading(frame, readings.front())) {
+                        malformed = true;
+                        break;
+                    }
+
+                    std::vector<DeviceReading> batch;
+                    batch.reserve(readings.size());
+                    for (const WireProtocol::BinaryReading& reading : readings) {
+                        DeviceReading device_reading;
+                        if (reading.references_slot || !make_binary_reading(reading.device_id, reading, device_reading)) {
+                            malformed = true;
+                            continue;
+                        }
+                        batch.push_back(std::move(device_reading));
+                    }
+                    if (!batch.empty()) {
+                        shed |= !submit_datagram(client_ip, std::move(batch));
+                    }
+                    payload.remove_prefix(frame_len);
+                }
+            } else {
+                while (!payload.empty()) {
+                    size_t end = payload.find('\n');
+                    std::string_view line = payload.substr(0, end);
+                    while (!line.empty() && line.back() == '\r') {
+                        line.remove_suffix(1);
+                    }
+                    if (!line.empty()) {
+                        std::vector<DeviceReading> batch;
+                        malformed |= handle_request(client_ip, line, batch).rejected > 0;
+                        if (!batch.empty()) {
+                            shed |= !submit_datagram(client_ip, std::move(batch));
+                        }
+                    }
+                    payload.remove_prefix(end == std::string_view::npos ? payload.size() : end + 1);
+                }
+            }
         }
 
-        sqlite3_close(db); // Đóng cơ sở dữ liệu sau khi hoàn thành công việc.
+        std::lock_guard<std::mutex> lock(udp_stats_mutex_);
+        auto it = udp_sources_.find(source);
+        if (it == udp_sources_.end() && udp_sources_.size() < kMaxUdpSources) {
+            it = udp_sources_.emplace(source, UdpSourceCounters{}).first;
+        }
+        UdpSourceCounters& counters = it != udp_sources_.end() ? it->second : udp_other_sources_;
+        ++counters.received;
+        counters.malformed += malformed;
+        counters.dropped += truncated || shed;
     }
 
+    bool submit_datagram(const std::string& client_ip, std::vector<DeviceReading> readings) {
+        IngestItem item{client_ip, std::move(readings), {}};
+        return ingest_queue_.push(item) != IngestQueue<IngestItem>::Admission::Shed;
+    }
 
-    static std::vector<SensorData> get_training_data() {
-        std::vector<SensorData> training_data; // Vector lưu trữ dữ liệu huấn luyện.
+    // Luồng ghi (group commit): gom các mục từ mọi kết nối thành nhóm tối đa commit_batch_rows bản ghi
+    // hoặc commit_interval_ms mili giây, tùy điều kiện nào đến trước, rồi ghi cả nhóm trong một giao dịch
+    // (một lần fsync). Các kết nối chỉ được báo (và gửi ACK) sau khi giao dịch đã commit.
+    void run_ingest_worker() {
+        std::vector<IngestItem> group;
+        while (true) {
+            collect_commit_group(group);
+            process_group(group);
+            group.clear();
+        }
+    }
 
-        sqlite3 *db; // Con trỏ đối tượng cơ sở dữ liệu SQLite.
-        int rc = sqlite3_open("lora.db", &db); // Mở cơ sở dữ liệu "lora.db".
+    void collect_commit_group(std::vector<IngestItem>& group) {
+        group.push_back(ingest_queue_.pop_wait());
+        std::size_t rows = group.back().readings.size();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.commit_interval_ms);
+        while (rows < config_.commit_batch_rows) {
+            // Với khoảng chờ 0, nhóm gồm những gì đã có sẵn trong hàng đợi.
+            std::optional<IngestItem> item = config_.commit_interval_ms == 0 ? ingest_queue_.try_pop()
+                                                                              : ingest_queue_.pop_until(deadline);
+            if (!item) {
+                break;
+            }
+            rows += item->readings.size();
+            group.push_back(std::move(*item));
+        }
+    }
 
-        if (rc) {
-            std::cerr << "Không thể mở cơ sở dữ liệu: " << sqlite3_errmsg(db) << std::endl; // In lỗi nếu không thể mở cơ sở dữ liệu.
-            sqlite3_close(db);
-            return training_data;
+    // Dự đoán và ghi mọi bản ghi của nhóm trong một giao dịch, lưu lịch sử, rồi báo cho từng mục.
+    void process_group(std::vector<IngestItem>& group) {
+        std::vector<DeviceReading> rows;
+        for (IngestItem& item : group) {
+            std::move(item.readings.begin(), item.readings.end(), std::back_inserter(rows));
         }
 
-        std::string select_query = "SELECT temperature FROM sensor_data WHERE prediction IS NOT NULL;"; // Câu lệnh truy vấn dữ liệu.
+        std::vector<bool> stored_rows;
+        std::vector<bool> repeated_rows;
+        std::size_t committed = update_sensor_data_with_prediction(rows, &stored_rows, &repeated_rows);
+        store_historical_data(rows, stored_rows, &repeated_rows);
+        if (committed > 0) {
+            committed_rows_.fetch_add(committed, std::memory_order_relaxed);
+            commits_.fetch_add(1, std::memory_order_relaxed);
+        }
 
-        sqlite3_stmt *stmt; // Đối tượng lưu trữ câu lệnh SQL đã được biên dịch.
-        rc = sqlite3_prepare_v2(db, select_query.c_str(), -1, &stmt, nullptr); // Chuẩn bị câu lệnh truy vấn.
+        std::size_t offset = 0;
+        for (IngestItem& item : group) {
+            std::size_t stored = 0;
+            for (std::size_t i = 0; i < item.readings.size(); ++i, ++offset) {
+                item.readings[i] = std::move(rows[offset]);
+                stored += stored_rows[offset];
+            }
 
-        if (rc != SQLITE_OK) {
-            std::cerr << "Lỗi chuẩn bị SQL: " << sqlite3_errmsg(db) << std::endl; // In lỗi nếu có lỗi chuẩn bị SQL.
-            sqlite3_close(db);
-            return training_data;
+            print_item(item);
+            if (item.on_stored) {
+                item.on_stored(stored); // Chỉ báo sau khi giao dịch đã commit.
+            }
         }
+    }
 
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            SensorData data; // Đối tượng lưu trữ dữ liệu cảm biến.
-            data.temperature = sqlite3_column_double(stmt, 0); // Lấy giá trị nhiệt độ từ cột 0.
+    void schedule_metrics_report() {
+        if (config_.metrics_interval_seconds == 0) {
+            return;
+        }
 
-            // Thiết lập các giá trị còn lại của SensorData mặc định là 0 hoặc chuỗi rỗng.
-            data.timestamp = "";
-            data.light_intensity = 0.0;
-            data.air_humidity = 0.0;
-            data.soil_humidity = 0.0;
+        metrics_timer_.expires_after(std::chrono::seconds(config_.metrics_interval_seconds));
+        metrics_timer_.async_wait([this](const boost::system::error_code& error) {
+            if (error) {
+                return;
+            }
+            report_metrics();
+            schedule_metrics_report();
+        });
+    }
 
-            training_data.push_back(data); // Thêm dữ liệu vào vector huấn luyện.
+    // In số liệu thống kê ra màn hình.
+    void report_metrics() {
+        std::ostringstream out;
+
+        out << "[metrics] ingest depth=" << ingest_queue_.depth() << " max_depth=" << ingest_queue_.max_depth()
+            << " capacity=" << ingest_queue_.capacity() << " enqueued=" << ingest_queue_.enqueued()
+            << " shed=" << ingest_queue_.shed() << " overloaded=" << ingest_queue_.overloaded() << "\n";
+
+        std::uint64_t commits = commits_.load(std::memory_order_relaxed);
+        std::uint64_t committed_rows = committed_rows_.load(std::memory_order_relaxed);
+        out << "[metrics] writer commits=" << commits << " rows=" << committed_rows << " rows_per_commit="
+            << (commits == 0 ? 0.0 : static_cast<double>(committed_rows) / static_cast<double>(commits)) << "\n";
+
+        storage_->report_metrics(out);
+
+        {
+            std::size_t devices = 0;
+            std::size_t samples = 0;
+            std::size_t bytes = 0;
+            lora_devices.for_each([&](const std::string&, const DeviceData& device) {
+                ++devices;
+                samples += device.history.size();
+                bytes += device.history.memory_bytes();
+            });
+            out << "[metrics] history devices=" << devices << " samples=" << samples << " bytes=" << bytes
+                << " per_device_limit=" << config_.history_size << "\n";
         }
 
-        sqlite3_finalize(stmt); // Giải phóng bộ nhớ đã được cấp phát cho câu lệnh SQL.
-        sqlite3_close(db); // Đóng cơ sở dữ liệu sau khi hoàn thành công việc.
+        if (read_pool_) {
+            out << "[metrics] queries executed=" << queries_.load(std::memory_order_relaxed)
+                << " rejected=" << rejected_queries_.load(std::memory_order_relaxed)
+                << " pending=" << pending_queries_.load(std::memory_order_relaxed)
+                << " pool_waits=" << read_pool_->waits() << "\n";
+        }
+
+        out << "[metrics] connections open=" << open_connections_.load(std::memory_order_relaxed)
+            << " reaped=" << reaped_connections_.load(std::memory_order_relaxed)
+            << " rejected_per_ip=" << rejected_connections_.load(std::memory_order_relaxed) << "\n";
+
+#ifdef LORA_WITH_IO_URING
+        if (!uring_loops_.empty()) {
+            std::uint64_t accepted = 0;
+            std::uint64_t enter_calls = 0;
+            for (const auto& loop : uring_loops_) {
+                accepted += loop->accepted();
+                enter_calls += loop->enter_calls();
+            }
+            std::uint64_t items = ingest_queue_.enqueued();
+            out << "[metrics] uring accepted=" << accepted << " net_enter_calls=" << enter_calls
+                << " log_writes=" << uring_log_->writes() << " log_enter_calls=" << uring_log_->enter_calls()
+                << " enter_calls_per_item="
+                << (items == 0 ? 0.0 : static_cast<double>(enter_calls + uring_log_->enter_calls()) / static_cast<double>(items))
+                << "\n";
+        }
+#endif
+
+        if (udp_socket_.is_open()) {
+            std::lock_guard<std::mutex> lock(udp_stats_mutex_);
+            out << "[metrics] udp kernel_drops=" << udp_kernel_drops_ << "\n";
+            for (const auto& [source, counters] : udp_sources_) {
+                out << "[metrics] udp source=" << source.to_string() << " received=" << counters.received
+                    << " malformed=" << counters.malformed << " dropped=" << counters.dropped << "\n";
+            }
+            if (udp_other_sources_.received > 0) {
+                out << "[metrics] udp source=other received=" << udp_other_sources_.received
+                    << " malformed=" << udp_other_sources_.malformed << " dropped=" << udp_other_sources_.dropped << "\n";
+            }
+        }
+
+        std::cout << out.str() << std::flush;
+    }
+
+    // Mở backend được chọn bằng --storage-engine; nếu không mở được thì bản ghi vào sensor_data như trước.
+    // user_control luôn ở lora.db nên schema của nó vẫn được nâng cấp khi bản ghi cảm biến nằm nơi khác.
+    void open_storage() {
+        switch (config_.storage_engine) {
+            case StorageEngine::Columnar:
+#ifndef _WIN32
+                storage_ = std::make_unique<ColumnarBackend>(config_.columnar_dir, config_.checkpoint_interval_seconds > 0);
+#else
+                std::cerr << "Columnar storage engine is not available on this platform, using SQLite." << std::endl;
+#endif
+                break;
+            case StorageEngine::Memory:
+                storage_ = std::make_unique<MemoryBackend>();
+                break;
+            case StorageEngine::Sqlite:
+                break;
+        }
+        if (storage_ && !storage_->open()) {
+            std::cerr << "Không mở được nơi lưu " << storage_->name() << ", dùng SQLite." << std::endl;
+            storage_.reset();
+        }
+        if (storage_) {
+            SqliteBackend::migrate_schema();
+            if (config_.change_only) {
+                std::cout << "Change-only storage applies to SQLite only; ignored with the " << storage_->name()
+                          << " engine." << std::endl;
+            }
+            return;
+        }
+        storage_ = std::make_unique<SqliteBackend>(config_);
+        storage_->open(); // Lỗi được in ra bên trong; máy chủ vẫn chạy và báo lỗi ở từng lô.
+    }
+
+    // Mở nhóm kết nối chỉ đọc và các luồng phục vụ "QUERY ...". Kết nối đọc user_control trong lora.db, và cả
+    // sensor_data khi backend là SQLite; backend khác tự trả lời QUERY READINGS.
+    void start_queries() {
+        if (config_.query_threads == 0) {
+            return;
+        }
+        auto pool = std::make_unique<SqliteReadPool>(SqliteBackend::kDatabasePath, config_.query_threads);
+        if (!pool->open(StorageSettings::for_profile(config_.storage_profile).mmap_size)) {
+            std::cerr << "Không mở được kết nối chỉ đọc; tắt truy vấn." << std::endl;
+            return;
+        }
+        read_pool_ = std::move(pool);
+        if (auto* sqlite = dynamic_cast<SqliteBackend*>(storage_.get())) {
+            sqlite->set_read_pool(read_pool_.get());
+        }
+        query_threads_ = std::make_unique<boost::asio::thread_pool>(config_.query_threads);
+        std::cout << "Query threads: " << config_.query_threads << " (read-only connections to lora.db)" << std::endl;
+    }
+
+    // Đưa một truy vấn cho các luồng truy vấn; done(reply) được gọi trên luồng truy vấn.
+    // Trả về false nếu đã có quá nhiều truy vấn đang chờ.
+    bool submit_query(std::string request, std::function<void(std::string)> done) {
+        if (!read_pool_) {
+            done("ERR QUERY disabled\n");
+            return true;
+        }
+        if (pending_queries_.fetch_add(1, std::memory_order_relaxed) >= kMaxPendingQueries) {
+            pending_queries_.fetch_sub(1, std::memory_order_relaxed);
+            rejected_queries_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        boost::asio::post(*query_threads_, [this, request = std::move(request), done = std::move(done)]() {
+            std::string reply = execute_query(request);
+            pending_queries_.fetch_sub(1, std::memory_order_relaxed);
+            queries_.fetch_add(1, std::memory_order_relaxed);
+            done(std::move(reply));
+        });
+        return true;
+    }
+
+    // "QUERY READINGS <device_id> <from_ms> <to_ms>": các hàng "ROW <timestamp_ms> <light> <temperature>
+    // <air_humidity> <soil_humidity> <prediction>" của backend lưu trữ đang dùng (query_range()) theo thời gian,
+    // tối đa kMaxQueryRows hàng.
+    // "QUERY CONTROL <device_id>": lệnh mới nhất của thiết bị, "CONTROL <timestamp_ms> <command>" (lệnh là phần
+    // còn lại của dòng).
+    // "QUERY LATEST <device_id>" và "QUERY RECENT <device_id> <seconds>": bản ghi mới nhất, hoặc các bản ghi
+    // trong seconds giây tính tới bản mới nhất, lấy từ lịch sử trong bộ nhớ (không đọc lora.db), dạng "ROW ...".
+    // Cả hai kết thúc bằng "END <số hàng>"; yêu cầu sai cú pháp hoặc lỗi SQL nhận "ERR QUERY".
+    std::string execute_query(std::string_view request) {
+        request.remove_prefix(kQueryPrefix.size());
+        std::vector<std::string_view> fields;
+        while (!request.empty()) {
+            std::size_t end = request.find(' ');
+            if (end != 0) {
+                fields.push_back(request.substr(0, end));
+            }
+            request.remove_prefix(end == std::string_view::npos ? request.size() : end + 1);
+        }
+
+        std::string reply;
+        std::size_t rows = 0;
+        bool ok = false;
+        std::int64_t from_ms = 0;
+        std::int64_t to_ms = 0;
+        std::int64_t seconds = 0;
+        if (fields.size() == 4 && fields[0] == "READINGS" && parse_int(fields[2], from_ms) && parse_int(fields[3], to_ms)) {
+            ok = storage_->query_range(std::string(fields[1]), from_ms, to_ms, kMaxQueryRows, [&](const SensorData& data) {
+                append_row(reply, data);
+                ++rows;
+            });
+        } else if (fields.size() == 2 && fields[0] == "CONTROL") {
+            read_pool_->read([&](SqliteConnection& db) {
+                Statement stmt(db, kQueryControlSql);
+                if (!stmt) {
+                    return;
+                }
+                sqlite3_bind_text(stmt.get(), 1, fields[1].data(), static_cast<int>(fields[1].size()), SQLITE_STATIC);
+                int rc = sqlite3_step(stmt.get());
+                if (rc == SQLITE_ROW) {
+                    reply += "CONTROL ";
+                    reply += std::to_string(sqlite3_column_int64(stmt.get(), 1));
+                    reply += ' ';
+                    reply += column_or_dash(stmt.get(), 0);
+                    reply += '\n';
+                    ++rows;
+                }
+                ok = rc == SQLITE_ROW || rc == SQLITE_DONE;
+            });
+        } else if ((fields.size() == 2 && fields[0] == "LATEST") ||
+                   (fields.size() == 3 && fields[0] == "RECENT" && parse_int(fields[2], seconds) && seconds >= 0)) {
+            lora_devices.read(fields[1], [&](const DeviceData& device) {
+                const DeviceHistory& history = device.history;
+                SensorData data;
+                if (fields[0] == "LATEST") {
+                    if (history.latest(data)) {
+                        append_row(reply, data);
+                        ++rows;
+                    }
+                } else if (history.latest(data)) {
+                    history.for_each_since(data.timestamp_ms - seconds * 1000, [&](const SensorData& recent) {
+                        append_row(reply, recent);
+                        ++rows;
+                    });
+                }
+            });
+            ok = true;
+        }
+        if (!ok) {
+            return "ERR QUERY\n";
+        }
+        return reply + "END " + std::to_string(rows) + "\n";
+    }
+
+    // "ROW <timestamp_ms> <light> <temperature> <air_humidity> <soil_humidity> <prediction>"; nhãn rỗng thành "-".
+    static void append_row(std::string& out, const SensorData& data) {
+        out += "ROW ";
+        out += std::to_string(data.timestamp_ms);
+        for (double value : {data.light_intensity, data.temperature, data.air_humidity, data.soil_humidity}) {
+            out += ' ';
+            append_number(out, value);
+        }
+        out += ' ';
+        out += data.prediction.empty() ? "-" : data.prediction;
+        out += '\n';
+    }
+
+    static bool parse_int(std::string_view text, std::int64_t& value) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && end == text.data() + text.size();
+    }
+
+    // Dạng ngắn nhất đọc lại được đúng giá trị.
+    static void append_number(std::string& out, double value) {
+        char buffer[32];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, ec == std::errc() ? end : buffer);
+    }
+
+    // Văn bản của cột, hoặc "-" nếu NULL hoặc rỗng (phản hồi tách trường bằng dấu cách).
+    static std::string column_or_dash(sqlite3_stmt* stmt, int column) {
+        const unsigned char* text = sqlite3_column_text(stmt, column);
+        return text != nullptr && *text != '\0' ? reinterpret_cast<const char*>(text) : "-";
+    }
+
+    std::vector<SensorData> get_training_data() {
+        std::vector<SensorData> training_data; // Vector lưu trữ dữ liệu huấn luyện.
+
+        // Chỉ nhiệt độ được dùng; các giá trị còn lại của SensorData mặc định là 0 hoặc chuỗi rỗng.
+        storage_->scan_training([&training_data](double temperature) {
+            SensorData data; // Đối tượng lưu trữ dữ liệu cảm biến.
+            data.temperature = temperature;
+            training_data.push_back(data); // Thêm dữ liệu vào vector huấn luyện.
+        });
 
         return training_data; // Trả về vector chứa dữ liệu huấn luyện.
     }
@@ -172,7 +1468,7 @@ private:
         const double min_light_intensity = 1500.0;
         const double max_light_intensity = 2000.0;
 
-        int current_hour = getHourFromTimestamp(sensor_data.timestamp); // Lấy giờ hiện tại từ dấu thời gian.
+        int current_hour = getHourFromTimestamp(sensor_data.timestamp_ms); // Lấy giờ hiện tại từ dấu thời gian.
 
         bool is_daytime = (current_hour >= 6 && current_hour < 18); // Kiểm tra xem có phải ban ngày không.
 
@@ -181,7 +1477,7 @@ private:
         // Duyệt qua từng mẫu dữ liệu trong dữ liệu huấn luyện.
         for (const SensorData& training_sample : training_data) {
 
-            int training_hour = getHourFromTimestamp(training_sample.timestamp); // Lấy giờ từ dấu thời gian của mẫu huấn luyện.
+            int training_hour = getHourFromTimestamp(training_sample.timestamp_ms); // Lấy giờ từ dấu thời gian của mẫu huấn luyện.
 
             bool is_air_humid = (sensor_data.air_humidity >= min_air_humidity && sensor_data.air_humidity <= max_air_humidity); // Kiểm tra độ ẩm không khí có nằm trong ngưỡng không.
             bool is_light_sufficient = (sensor_data.light_intensity >= min_light_intensity && sensor_data.light_intensity <= max_light_intensity); // Kiểm tra độ sáng ánh sáng có đủ.
@@ -228,12 +1524,9 @@ private:
         return (training_hour >= 18 || training_hour < 6);
     }
 
-    static int getHourFromTimestamp(const std::string& timestamp) {
-        // Phân tích thời gian từ timestamp và lấy giờ
-        std::tm tm_time = {};
-        std::istringstream ss(timestamp);
-        ss >> std::get_time(&tm_time, "%Y-%m-%d %H:%M:%S");
-        return tm_time.tm_hour;
+    // Giờ địa phương (0..23) của một dấu thời gian; ngày và đêm được xét theo giờ nơi đặt máy chủ.
+    static int getHourFromTimestamp(std::int64_t timestamp_ms) {
+        return local_hour(timestamp_ms);
     }
 
     static double calculateEuclideanDistance(const SensorData& data1, const SensorData& data2) {
@@ -244,9 +1537,20 @@ private:
         return std::sqrt(distance);
     }
 
-    static void update_sensor_data_with_prediction(const std::string& device_id, SensorData& sensor_data) {
+    // Dự đoán cho từng bản ghi rồi ghi cả lô vào nơi lưu trong một giao dịch duy nhất.
+    // Trả về số bản ghi đã được ghi và commit; 0 nếu giao dịch thất bại. Nếu stored_rows khác nullptr,
+    // phần tử thứ i cho biết bản ghi thứ i đã được commit hay chưa. Nếu repeated_rows khác nullptr,
+    // phần tử thứ i cho biết bản ghi thứ i chỉ kéo dài run của thiết bị (--change-only) thay vì thành hàng mới.
+    std::size_t update_sensor_data_with_prediction(std::vector<DeviceReading>& batch, std::vector<bool>* stored_rows = nullptr,
+                                                   std::vector<bool>* repeated_rows = nullptr) {
         std::vector<SensorData> training_data = get_training_data();
+        return storage_->insert_batch(batch, [&training_data](SensorData& sensor_data) {
+            annotate_reading(sensor_data, training_data);
+        }, stored_rows, repeated_rows);
+    }
 
+    // Dự đoán môi trường và ghi chú các chỉ số bất thường cho một bản ghi.
+    static void annotate_reading(SensorData& sensor_data, const std::vector<SensorData>& training_data) {
         std::string prediction = predict_environment(sensor_data, training_data, 3);
 
         // Kiểm tra nhiệt độ
@@ -275,130 +1579,184 @@ private:
             sensor_data.note = "";
         }
 
-        // Cập nhật cơ sở dữ liệu
-        sqlite3 *db;
-        int rc = sqlite3_open("lora.db", &db); // Mở hoặc tạo cơ sở dữ liệu "lora.db".
-        if (rc) {
-            std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl; // In lỗi nếu không thể mở cơ sở dữ liệu.
-            sqlite3_close(db);
-            return;
-        }
-
-        std::string insert_query = "INSERT INTO sensor_data (device_id, light_intensity, temperature, air_humidity, soil_humidity, timestamp, prediction, note) "
-                                   "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
-
-        sqlite3_stmt *stmt;
-        rc = sqlite3_prepare_v2(db, insert_query.c_str(), -1, &stmt, nullptr); // Chuẩn bị câu lệnh SQL.
+        sensor_data.prediction = prediction;
+    }
 
-        if (rc != SQLITE_OK) {
-            std::cerr << "SQL prepare error: " << sqlite3_errmsg(db) << std::endl;
-            sqlite3_close(db);
-            return;
+    // Lưu các bản ghi đã được ghi xuống (stored_rows[i]) vào lịch sử (mỗi bản ghi chỉ khóa shard của thiết bị
+    // đó) và ghi log với một lần mở tệp; bản ghi của giao dịch thất bại (thiết bị nhận NAK) bị bỏ qua.
+    // Bản ghi có repeated_rows[i] (chỉ kéo dài một run) vẫn vào lịch sử nhưng không ghi thêm dòng log.
+    void store_historical_data(const std::vector<DeviceReading>& batch, const std::vector<bool>& stored_rows,
+                               const std::vector<bool>* repeated_rows = nullptr) {
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (stored_rows[i]) {
+                const DeviceReading& reading = batch[i];
+                lora_devices.update(reading.device_id, [&](DeviceData& device) { device.history.append(reading.sensor_data); });
+            }
         }
-        // Gắn giá trị vào câu lệnh SQL.
-        sqlite3_bind_text(stmt, 1, device_id.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_double(stmt, 2, sensor_data.light_intensity);
-        sqlite3_bind_double(stmt, 3, sensor_data.temperature);
-        sqlite3_bind_double(stmt, 4, sensor_data.air_humidity);
-        sqlite3_bind_double(stmt, 5, sensor_data.soil_humidity);
-        sqlite3_bind_text(stmt, 6, sensor_data.timestamp.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 7, prediction.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 8, sensor_data.note.c_str(), -1, SQLITE_STATIC);
 
-        rc = sqlite3_step(stmt);
-        if (rc != SQLITE_DONE) {
-            std::cerr << "SQL execution error: " << sqlite3_errmsg(db) << std::endl;
+        std::ostringstream lines;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (stored_rows[i] && (repeated_rows == nullptr || !(*repeated_rows)[i])) {
+                write_log_line(lines, batch[i].device_id, batch[i].sensor_data);
+            }
         }
-
-        sqlite3_finalize(stmt); // Giải phóng bộ nhớ đã được cấp phát cho câu lệnh SQL.
-        sqlite3_close(db); // Đóng cơ sở dữ liệu sau khi hoàn thành công việc.
+        append_log(lines.str());
     }
 
-    void store_historical_data(const std::string& device_id, const SensorData& sensor_data) {
-        // Khóa mutex để tránh xung đột dữ liệu giữa các luồng
-        std::lock_guard<std::mutex> lock(devices_mutex);
-        // Nếu thiết bị đã tồn tại trong danh sách, thêm dữ liệu cảm biến vào lịch sử của nó
-        if (lora_devices.find(device_id) != lora_devices.end()) {
-            lora_devices[device_id].sensor_data_history.push_back(sensor_data);
-        } else {
-            // Nếu không, tạo một thiết bị mới và thêm vào danh sách
-            DeviceData new_device_data;
-            new_device_data.device_id = device_id;
-            new_device_data.sensor_data_history = {sensor_data};
-            lora_devices[device_id] = new_device_data;
+    // Nối các dòng vào tệp log.txt: qua io_uring nếu đang bật (tệp mở sẵn, không chờ ghi xong),
+    // nếu không thì mở tệp, ghi và đóng lại như trước.
+    void append_log(std::string lines) {
+#ifdef LORA_WITH_IO_URING
+        if (uring_log_) {
+            uring_log_->append(std::move(lines));
+            return;
         }
-
-        // Mở tệp log.txt và ghi dữ liệu cảm biến nhận được vào tệp
+#endif
         std::ofstream logfile("log.txt", std::ios_base::app);
         if (logfile.is_open()) {
-            logfile << "Received data from device " << device_id << ": "
-                    << "Light Intensity: " << sensor_data.light_intensity << ", "
-                    << "Temperature: " << sensor_data.temperature << ", "
-                    << "Air Humidity: " << sensor_data.air_humidity << ", "
-                    << "Soil Humidity: " << sensor_data.soil_humidity << " at timestamp "
-                    << sensor_data.timestamp << std::endl;
+            logfile << lines;
             logfile.close();
         }
     }
 
-    // Hàm gửi phản hồi đến thiết bị gửi dữ liệu
-    static void send_acknowledgment(tcp::socket& socket, const std::string& response) {
-        boost::system::error_code error;
-        socket.write_some(boost::asio::buffer(response), error);
+    static void write_log_line(std::ostream& logfile, const std::string& device_id, const SensorData& sensor_data) {
+        logfile << "Received data from device " << device_id << ": "
+                << "Light Intensity: " << sensor_data.light_intensity << ", "
+                << "Temperature: " << sensor_data.temperature << ", "
+                << "Air Humidity: " << sensor_data.air_humidity << ", "
+                << "Soil Humidity: " << sensor_data.soil_humidity << " at timestamp "
+                << format_timestamp(sensor_data.timestamp_ms) << "\n";
     }
 
-    void handle_request(tcp::socket socket) {
-        boost::system::error_code error;
+    // Phản hồi cho một lô: số bản ghi đã lưu trên tổng số bản ghi trong lô.
+    static std::string batch_acknowledgment(std::size_t accepted, std::size_t total) {
+        return "ACK BATCH " + std::to_string(accepted) + "/" + std::to_string(total) + "\n";
+    }
 
-        // Xác định địa chỉ IP của thiết bị gửi dữ liệu
-        tcp::endpoint remote_endpoint = socket.remote_endpoint();
-        std::string client_ip = remote_endpoint.address().to_string();
+    // Kiểm tra bản ghi nhị phân như bản ghi văn bản (ReadingParser::validate: ID, khoảng giá trị, dấu thời
+    // gian) rồi mới chuyển thành DeviceReading; out không đổi nếu bị từ chối.
+    static ReadingParser::Result make_binary_reading(std::string_view device_id, const WireProtocol::BinaryReading& reading,
+                                                     DeviceReading& out) {
+        ReadingParser::Result result = ReadingParser::validate(device_id, reading.values, reading.device_timestamp_ms);
+        if (result) {
+            out.device_id.assign(device_id);
+            out.sensor_data = to_sensor_data(reading);
+        }
+        return result;
+    }
 
-        char buffer[1024];
-        size_t len = socket.read_some(boost::asio::buffer(buffer), error);
+    // Chuyển khung nhị phân đã giải mã thành SensorData.
+    static SensorData to_sensor_data(const WireProtocol::BinaryReading& reading) {
+        SensorData sensor_data;
+        sensor_data.light_intensity = reading.values[0];
+        sensor_data.temperature = reading.values[1];
+        sensor_data.air_humidity = reading.values[2];
+        sensor_data.soil_humidity = reading.values[3];
+        sensor_data.timestamp_ms = reading.device_timestamp_ms != 0 ? reading.device_timestamp_ms : current_time_ms();
+        return sensor_data;
+    }
 
-        if (!error) {
-            std::string data(buffer, len);
+    // Phân tích một bản ghi văn bản "id:l t a s", hoặc một lô "BATCH id1:l t a s@ts;id2:l t a s@ts;..."
+    // với dấu thời gian thiết bị (mili giây epoch) tùy chọn. Các bản ghi hợp lệ được thêm vào readings
+    // để đưa vào hàng đợi nhập liệu.
+    static RequestResult handle_request(const std::string& client_ip, std::string_view data, std::vector<DeviceReading>& readings) {
+        RequestResult result;
+
+        if (data.substr(0, kBatchPrefix.size()) == kBatchPrefix) {
+            result.batch = true;
+            data.remove_prefix(kBatchPrefix.size());
+
+            ReadingParser::Result first_error;
+            while (!data.empty()) {
+                size_t end = data.find(';');
+                std::string_view tuple = data.substr(0, end);
+                DeviceReading reading;
+                if (!tuple.empty()) {
+                    ReadingParser::Result parsed = parse_text_reading(tuple, reading);
+                    if (parsed) {
+                        readings.push_back(std::move(reading));
+                    } else {
+                        if (result.rejected == 0) {
+                            first_error = parsed;
+                        }
+                        ++result.rejected;
+                    }
+                }
+                data.remove_prefix(end == std::string_view::npos ? data.size() : end + 1);
+            }
+
+            if (result.rejected > 0) {
+                std::cerr << "Error parsing " << result.rejected << " readings in batch from " << client_ip
+                          << " (first: " << describe_parse_error(first_error) << ")." << std::endl;
+            }
+            result.accepted = readings.size();
+            return result;
+        }
 
-            size_t pos = data.find(':');
-            if (pos != std::string::npos) {
-                // Tách chuỗi dữ liệu thành ID thiết bị và dữ liệu cảm biến
+        DeviceReading reading;
+        ReadingParser::Result parsed = parse_text_reading(data, reading);
+        if (parsed) {
+            readings.push_back(std::move(reading));
+            result.accepted = 1;
+        } else {
+            std::cerr << "Error parsing sensor data from " << client_ip << ": " << describe_parse_error(parsed) << "." << std::endl;
+            result.rejected = 1;
+        }
+        return result;
+    }
 
-                std::string device_id = data.substr(0, pos);
-                std::string sensor_data_str = data.substr(pos + 1);
+    static std::string describe_parse_error(const ReadingParser::Result& result) {
+        std::string message = ReadingParser::error_message(result.error);
+        if (result.field >= 0) {
+            message += std::string(" (") + ReadingParser::field_name(result.field) + ")";
+        }
+        return message;
+    }
 
-                SensorData sensor_data;
-                // Phân tích dữ liệu cảm biến từ chuỗi và lưu vào biến sensor_data
-                if (sscanf(sensor_data_str.c_str(), "%lf %lf %lf %lf",
-                           &sensor_data.light_intensity, &sensor_data.temperature,
-                           &sensor_data.air_humidity, &sensor_data.soil_humidity) == 4) {
-                    if (!device_id.empty()) {
-                        // Lấy thời điểm hiện tại và lưu dữ liệu vào lịch sử và dự đoán cảm biến
-                        sensor_data.timestamp = get_current_timestamp();
-                        store_historical_data(device_id, sensor_data);
-                        update_sensor_data_with_prediction(device_id, sensor_data);
+    // Phân tích "id:l t a s" với hậu tố "@<mili giây epoch>" tùy chọn. Không có hậu tố thì dùng giờ máy chủ.
+    static ReadingParser::Result parse_text_reading(std::string_view record, DeviceReading& out) {
+        ReadingParser::Reading parsed;
+        ReadingParser::Result result = ReadingParser::parse(record, parsed);
+        if (!result) {
+            return result;
+        }
 
+        out.device_id.assign(parsed.device_id);
+        SensorData& sensor_data = out.sensor_data;
+        sensor_data.light_intensity = parsed.values[0];
+        sensor_data.temperature = parsed.values[1];
+        sensor_data.air_humidity = parsed.values[2];
+        sensor_data.soil_humidity = parsed.values[3];
+        sensor_data.timestamp_ms = parsed.device_timestamp_ms != 0 ? parsed.device_timestamp_ms : current_time_ms();
+        return result;
+    }
 
-                        // In thông tin dữ liệu cảm biến nhận được ra màn hình
-                        std::cout << "Received data from device " << device_id << " at IP " << client_ip << ": " << std::endl;
-                        std::cout << "  Light Intensity: " << sensor_data.light_intensity << std::endl;
-                        std::cout << "  Temperature: " << sensor_data.temperature << std::endl;
-                        std::cout << "  Air Humidity: " << sensor_data.air_humidity << std::endl;
-                        std::cout << "  Soil Humidity: " << sensor_data.soil_humidity << std::endl;
-                    }
-                } else {
-                    std::cerr << "Error parsing sensor data." << std::endl;
-                }
-            }
+    // In bản ghi đã xử lý ra màn hình. Dùng chung cho cả định dạng văn bản và nhị phân.
+    static void print_item(const IngestItem& item) {
+        if (item.readings.size() != 1 || item.on_stored) {
+            std::cout << "Received batch of " << item.readings.size() << " readings at IP " << item.client_ip << std::endl;
+            return;
         }
 
-        socket.close();
+        // In thông tin dữ liệu cảm biến nhận được ra màn hình
+        const DeviceReading& reading = item.readings.front();
+        const SensorData& sensor_data = reading.sensor_data;
+        std::cout << "Received data from device " << reading.device_id << " at IP " << item.client_ip << ": " << std::endl;
+        std::cout << "  Light Intensity: " << sensor_data.light_intensity << std::endl;
+        std::cout << "  Temperature: " << sensor_data.temperature << std::endl;
+        std::cout << "  Air Humidity: " << sensor_data.air_humidity << std::endl;
+        std::cout << "  Soil Humidity: " << sensor_data.soil_humidity << std::endl;
+    }
+
+    // Thời điểm hiện tại, mili giây kể từ epoch (UTC), cùng đơn vị với cột timestamp.
+    static std::int64_t current_time_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
     }
 
-    // Lấy thời điểm hiện tại dưới dạng chuỗi
-    static std::string get_current_timestamp() {
-        time_t now = time(0);
-        tm* timestamp = localtime(&now);
+    // Định dạng một dấu thời gian theo giờ địa phương cho người đọc (log.txt); cơ sở dữ liệu chỉ lưu số nguyên.
+    static std::string format_timestamp(std::int64_t timestamp_ms) {
+        time_t when = static_cast<time_t>(timestamp_ms / 1000);
+        tm* timestamp = localtime(&when);
         char timestamp_str[20];
         strftime(timestamp_str, sizeof(timestamp_str), "%Y-%m-%d %H:%M:%S", timestamp);
         return timestamp_str;
@@ -422,14 +1780,13 @@ void runPythonScript(const char* scriptPath) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     const char* testScriptPath = "F:/Source/C++/Database_Server/test.py";
     const char* mainScriptPath = "F:/Source/C++/Database_Server/api.py";
 
-    std::string server_ip = "192.168.172.152";
-    unsigned short server_port = 12345;
+    ServerConfig config = ServerConfig::from_command_line(argc, argv); // Đọc cấu hình từ dòng lệnh.
 
-    LoRaServer server(server_ip, server_port);
+    LoRaServer server(config);
     std::thread serverThread([&server]() { server.start(); });
 
     std::thread testThread(runPythonScript, testScriptPath);
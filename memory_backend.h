@@ -0,0 +1,91 @@
+#ifndef DATABASE_SERVER_MEMORY_BACKEND_H
+#define DATABASE_SERVER_MEMORY_BACKEND_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage_backend.h"
+
+// Bản ghi cảm biến chỉ nằm trong bộ nhớ (--storage-engine=memory): không fsync, không SQL, mất khi dừng
+// máy chủ và không giới hạn dung lượng. Dùng để đo thông lượng CPU của máy chủ (mạng, phân tích, dự đoán,
+// log) khi tầng lưu trữ gần như không tốn gì.
+class MemoryBackend : public StorageBackend {
+public:
+    const char* name() const override { return "memory"; }
+
+    bool open() override {
+        std::cout << "Storage engine: memory (readings are lost on exit)" << std::endl;
+        return true;
+    }
+
+    std::size_t insert_batch(std::vector<DeviceReading>& batch, const Annotate& annotate, std::vector<bool>* stored_rows,
+                             std::vector<bool>* repeated_rows) override {
+        if (repeated_rows != nullptr) {
+            repeated_rows->assign(batch.size(), false);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (DeviceReading& reading : batch) {
+            annotate(reading.sensor_data);
+            auto [it, inserted] = series_.try_emplace(reading.device_id);
+            it->second.push_back(reading.sensor_data);
+            if (!reading.sensor_data.prediction.empty()) {
+                labelled_temperatures_.push_back(reading.sensor_data.temperature);
+            }
+            if (inserted) {
+                devices_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        rows_.fetch_add(batch.size(), std::memory_order_relaxed);
+        if (stored_rows != nullptr) {
+            stored_rows->assign(batch.size(), true);
+        }
+        return batch.size();
+    }
+
+    void scan_training(const std::function<void(double)>& fn) override {
+        for (double temperature : labelled_temperatures_) {
+            fn(temperature);
+        }
+    }
+
+    // Quét tuần tự các bản ghi của thiết bị theo thứ tự đến.
+    bool query_range(const std::string& device_id, std::int64_t from_ms, std::int64_t to_ms, std::size_t limit,
+                     const std::function<void(const SensorData&)>& fn) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = series_.find(device_id);
+        if (it == series_.end()) {
+            return true;
+        }
+        std::size_t rows = 0;
+        for (const SensorData& data : it->second) {
+            if (rows == limit) {
+                break;
+            }
+            if (data.timestamp_ms >= from_ms && data.timestamp_ms <= to_ms) {
+                fn(data);
+                ++rows;
+            }
+        }
+        return true;
+    }
+
+    void report_metrics(std::ostream& out) const override {
+        out << "[metrics] memory devices=" << devices_.load(std::memory_order_relaxed)
+            << " rows=" << rows_.load(std::memory_order_relaxed) << "\n";
+    }
+
+private:
+    std::mutex mutex_; // Giữ khi luồng xử lý ghi và khi luồng truy vấn đọc series_.
+    std::unordered_map<std::string, std::vector<SensorData>> series_; // Bản ghi của mỗi thiết bị, theo thứ tự đến.
+    std::vector<double> labelled_temperatures_; // Nhiệt độ của các bản ghi đã gán nhãn, cho scan_training().
+    std::atomic<std::uint64_t> devices_{0};
+    std::atomic<std::uint64_t> rows_{0};
+};
+
+#endif //DATABASE_SERVER_MEMORY_BACKEND_H
@@ -0,0 +1,135 @@
+#ifndef DATABASE_SERVER_ONLINE_BACKUP_H
+#define DATABASE_SERVER_ONLINE_BACKUP_H
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "sqlite_connection.h"
+
+// Sao lưu lora.db khi máy chủ đang ghi, bằng API backup của SQLite. Mỗi bước chỉ chép step_pages trang rồi
+// nghỉ pause, nên việc đọc tệp không tranh I/O với các fsync của group commit.
+//
+// Kết nối nguồn giữ một giao dịch đọc suốt bản sao: ở chế độ WAL người ghi vẫn commit bình thường, còn bản
+// sao là ảnh chụp nhất quán tại lúc bắt đầu. Nếu không giữ, mỗi bước mở giao dịch đọc mới, thấy tệp đã đổi
+// và sqlite3_backup_step() chép lại từ đầu, nên với luồng ghi liên tục bản sao không bao giờ xong. Cái giá là
+// WAL không được checkpoint qua ảnh chụp đó cho tới khi bản sao xong.
+//
+// Bản sao được ghi vào "<destination>.tmp" rồi đổi tên, nên destination luôn là một bản sao trọn vẹn.
+// run() chỉ chạy trên một luồng; các bộ đếm đọc được từ luồng in số liệu.
+class OnlineBackup {
+public:
+    OnlineBackup(std::string source, std::string destination, int step_pages, std::chrono::milliseconds pause)
+        : source_(std::move(source)), destination_(std::move(destination)), step_pages_(step_pages), pause_(pause) {}
+
+    // Chép toàn bộ nguồn sang destination. Trả về false (và giữ nguyên bản sao cũ) nếu thất bại.
+    bool run() {
+        const auto begin = std::chrono::steady_clock::now();
+        const std::string temporary = destination_ + ".tmp";
+        std::error_code ec;
+        std::filesystem::path parent = std::filesystem::path(destination_).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent, ec);
+        }
+        std::filesystem::remove(temporary, ec);
+
+        running_.store(true, std::memory_order_relaxed);
+        pages_copied_.store(0, std::memory_order_relaxed);
+        pages_total_.store(0, std::memory_order_relaxed);
+        bool ok = copy(temporary);
+        running_.store(false, std::memory_order_relaxed);
+
+        if (ok) {
+            std::filesystem::rename(temporary, destination_, ec);
+            if (ec) {
+                std::cerr << "Backup rename error: " << ec.message() << std::endl;
+                ok = false;
+            }
+        }
+        if (!ok) {
+            std::filesystem::remove(temporary, ec);
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        backups_.fetch_add(1, std::memory_order_relaxed);
+        last_duration_ms_.store(static_cast<std::uint64_t>(elapsed.count()), std::memory_order_relaxed);
+        last_bytes_.store(bytes_, std::memory_order_relaxed);
+        std::cout << "Backup of " << source_ << " to " << destination_ << ": " << pages_total_.load(std::memory_order_relaxed)
+                  << " pages (" << bytes_ << " bytes) in " << elapsed.count() << " ms" << std::endl;
+        return true;
+    }
+
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+    std::uint64_t pages_copied() const { return pages_copied_.load(std::memory_order_relaxed); }
+    std::uint64_t pages_total() const { return pages_total_.load(std::memory_order_relaxed); }
+    std::uint64_t backups() const { return backups_.load(std::memory_order_relaxed); }
+    std::uint64_t failures() const { return failures_.load(std::memory_order_relaxed); }
+    std::uint64_t last_duration_ms() const { return last_duration_ms_.load(std::memory_order_relaxed); }
+    std::uint64_t last_bytes() const { return last_bytes_.load(std::memory_order_relaxed); }
+
+private:
+    bool copy(const std::string& temporary) {
+        SqliteConnection source(source_);
+        SqliteConnection destination(temporary);
+        if (!source.open() || !destination.open()) {
+            return false;
+        }
+        // Giao dịch đọc bắt đầu ở câu SELECT đầu tiên, không phải ở BEGIN.
+        if (!source.exec("BEGIN;") || source.query_text("SELECT count(*) FROM sqlite_master;").empty()) {
+            return false;
+        }
+        const std::uint64_t page_size = std::stoull("0" + source.query_text("PRAGMA page_size;"));
+
+        sqlite3_backup* backup = sqlite3_backup_init(destination.handle(), "main", source.handle(), "main");
+        if (backup == nullptr) {
+            std::cerr << "Backup init error: " << destination.error_message() << std::endl;
+            source.exec("ROLLBACK;");
+            return false;
+        }
+        int rc;
+        do {
+            rc = sqlite3_backup_step(backup, step_pages_);
+            auto total = static_cast<std::uint64_t>(sqlite3_backup_pagecount(backup));
+            pages_total_.store(total, std::memory_order_relaxed);
+            pages_copied_.store(total - static_cast<std::uint64_t>(sqlite3_backup_remaining(backup)), std::memory_order_relaxed);
+            if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+                std::this_thread::sleep_for(pause_);
+            }
+        } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+        bytes_ = pages_total_.load(std::memory_order_relaxed) * page_size;
+
+        // sqlite3_backup_finish() trả về lỗi của bước cuối (nếu có); SQLITE_DONE nghĩa là đã chép xong.
+        rc = sqlite3_backup_finish(backup);
+        source.exec("ROLLBACK;"); // Chỉ kết thúc giao dịch đọc.
+        if (rc != SQLITE_OK) {
+            std::cerr << "Backup error: " << destination.error_message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::string source_;
+    std::string destination_;
+    int step_pages_;
+    std::chrono::milliseconds pause_;
+    std::uint64_t bytes_ = 0; // Kích thước của bản sao đang chép.
+    std::atomic<bool> running_{false};
+    std::atomic<std::uint64_t> pages_copied_{0}; // Tiến độ của bản sao đang chép (hoặc bản sao gần nhất).
+    std::atomic<std::uint64_t> pages_total_{0};
+    std::atomic<std::uint64_t> backups_{0};
+    std::atomic<std::uint64_t> failures_{0};
+    std::atomic<std::uint64_t> last_duration_ms_{0};
+    std::atomic<std::uint64_t> last_bytes_{0};
+};
+
+#endif //DATABASE_SERVER_ONLINE_BACKUP_H
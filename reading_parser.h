@@ -0,0 +1,186 @@
+#ifndef DATABASE_SERVER_READING_PARSER_H
+#define DATABASE_SERVER_READING_PARSER_H
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+// Phân tích một bản ghi văn bản "id:l t a s" với hậu tố "@<mili giây epoch>" tùy chọn.
+// Làm việc thẳng trên string_view trỏ vào bộ đệm nhận, dùng std::from_chars (không phụ thuộc locale)
+// và không cấp phát bộ nhớ. Kết quả chỉ hợp lệ khi bộ đệm còn sống.
+//
+// validate() áp cùng các kiểm tra ID, khoảng giá trị và dấu thời gian cho bản ghi đến từ khung nhị phân.
+class ReadingParser {
+public:
+    static constexpr std::size_t kMaxDeviceIdLength = 255; // Cùng giới hạn với khung nhị phân (u8 độ dài).
+    static constexpr int kValueCount = 4;
+
+    enum class Error {
+        None,
+        MissingSeparator, // Không có ':' giữa ID thiết bị và các giá trị.
+        EmptyDeviceId,
+        DeviceIdTooLong,
+        BadDeviceId, // ID chứa ':' hoặc ký tự điều khiển (làm hỏng log.txt và định dạng văn bản).
+        MissingValue, // Ít hơn 4 giá trị.
+        BadNumber, // Giá trị không phải số thực.
+        OutOfRange, // Giá trị nằm ngoài khoảng hợp lý của cảm biến.
+        TrailingData, // Còn dữ liệu sau giá trị thứ 4.
+        BadTimestamp, // Hậu tố '@' không phải số nguyên không âm.
+    };
+
+    // Lỗi kèm chỉ số giá trị gây lỗi (0..3: light, temperature, air, soil; -1 nếu không gắn với giá trị nào).
+    struct Result {
+        Error error = Error::None;
+        int field = -1;
+
+        explicit operator bool() const { return error == Error::None; }
+    };
+
+    struct Reading {
+        std::string_view device_id;
+        double values[kValueCount]{}; // light, temperature, air humidity, soil humidity.
+        std::int64_t device_timestamp_ms = 0; // 0 = dùng giờ máy chủ.
+    };
+
+    static Result parse(std::string_view record, Reading& out) {
+        std::size_t colon = record.find(':');
+        if (colon == std::string_view::npos) {
+            return {Error::MissingSeparator};
+        }
+        out.device_id = record.substr(0, colon);
+        if (Result checked = check_device_id(out.device_id); !checked) {
+            return checked;
+        }
+
+        const char* p = record.data() + colon + 1;
+        const char* end = record.data() + record.size();
+
+        out.device_timestamp_ms = 0;
+        for (const char* at = p; at != end; ++at) {
+            if (*at == '@') {
+                auto [ts_end, ec] = std::from_chars(at + 1, end, out.device_timestamp_ms);
+                if (ec != std::errc() || ts_end != end || out.device_timestamp_ms < 0) {
+                    return {Error::BadTimestamp};
+                }
+                end = at;
+                break;
+            }
+        }
+
+        for (int i = 0; i < kValueCount; ++i) {
+            p = skip_space(p, end);
+            if (p == end) {
+                return {Error::MissingValue, i};
+            }
+            if (*p == '+') {
+                ++p; // from_chars không nhận dấu '+', sscanf thì có.
+            }
+            double value;
+            auto [value_end, ec] = std::from_chars(p, end, value);
+            if (ec == std::errc::result_out_of_range) {
+                return {Error::OutOfRange, i};
+            }
+            if (ec != std::errc() || (value_end != end && !is_space(*value_end))) {
+                return {Error::BadNumber, i};
+            }
+            if (Result checked = check_value(i, value); !checked) {
+                return checked;
+            }
+            out.values[i] = value;
+            p = value_end;
+        }
+
+        if (skip_space(p, end) != end) {
+            return {Error::TrailingData};
+        }
+        return {};
+    }
+
+    // Các kiểm tra của parse() cho một bản ghi đã được giải mã ở nơi khác (khung nhị phân).
+    static Result validate(std::string_view device_id, const double (&values)[kValueCount], std::int64_t device_timestamp_ms) {
+        if (Result checked = check_device_id(device_id); !checked) {
+            return checked;
+        }
+        if (device_timestamp_ms < 0) {
+            return {Error::BadTimestamp};
+        }
+        for (int i = 0; i < kValueCount; ++i) {
+            if (Result checked = check_value(i, values[i]); !checked) {
+                return checked;
+            }
+        }
+        return {};
+    }
+
+    static const char* error_message(Error error) {
+        switch (error) {
+            case Error::None: return "ok";
+            case Error::MissingSeparator: return "missing ':' after device id";
+            case Error::EmptyDeviceId: return "empty device id";
+            case Error::DeviceIdTooLong: return "device id too long";
+            case Error::BadDeviceId: return "device id contains ':' or a control character";
+            case Error::MissingValue: return "missing value";
+            case Error::BadNumber: return "not a number";
+            case Error::OutOfRange: return "value out of range";
+            case Error::TrailingData: return "unexpected data after the fourth value";
+            default: return "invalid timestamp";
+        }
+    }
+
+    static const char* field_name(int field) {
+        static constexpr const char* kNames[kValueCount] = {"light intensity", "temperature", "air humidity", "soil humidity"};
+        return field >= 0 && field < kValueCount ? kNames[field] : "record";
+    }
+
+private:
+    struct Range {
+        double min;
+        double max;
+    };
+
+    // Khoảng hợp lý của từng cảm biến; giá trị ngoài khoảng là dấu hiệu cảm biến hỏng hoặc dữ liệu rác.
+    static constexpr Range kRanges[kValueCount] = {
+            {0.0, 200000.0}, // Ánh sáng (lux); nắng trực tiếp khoảng 120000.
+            {-50.0, 100.0}, // Nhiệt độ (°C).
+            {0.0, 100.0}, // Độ ẩm không khí (%).
+            {0.0, 100.0}, // Độ ẩm đất (%).
+    };
+
+    static Result check_device_id(std::string_view device_id) {
+        if (device_id.empty()) {
+            return {Error::EmptyDeviceId};
+        }
+        if (device_id.size() > kMaxDeviceIdLength) {
+            return {Error::DeviceIdTooLong};
+        }
+        for (char c : device_id) {
+            if (c == ':' || static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+                return {Error::BadDeviceId};
+            }
+        }
+        return {};
+    }
+
+    static Result check_value(int field, double value) {
+        if (!std::isfinite(value) || value < kRanges[field].min || value > kRanges[field].max) {
+            return {Error::OutOfRange, field};
+        }
+        return {};
+    }
+
+    static bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    static const char* skip_space(const char* p, const char* end) {
+        while (p != end && is_space(*p)) {
+            ++p;
+        }
+        return p;
+    }
+};
+
+#endif //DATABASE_SERVER_READING_PARSER_H
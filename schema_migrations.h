@@ -0,0 +1,98 @@
+#ifndef DATABASE_SERVER_SCHEMA_MIGRATIONS_H
+#define DATABASE_SERVER_SCHEMA_MIGRATIONS_H
+
+#include <sqlite3.h>
+
+#include <iostream>
+#include <span>
+#include <string>
+
+#include "sqlite_connection.h"
+
+// Một bước nâng cấp schema. version tăng dần và không bao giờ được sửa hay xóa sau khi đã phát hành:
+// thay đổi mới luôn là một bước mới ở cuối danh sách.
+struct SchemaMigration {
+    int version;
+    const char* description;
+    const char* sql;
+};
+
+// Nâng cấp cơ sở dữ liệu tại chỗ tới bước cuối cùng. Mỗi bước đã áp dụng được ghi một hàng trong bảng
+// schema_version; tệp cũ chưa có bảng này được coi là phiên bản 0. Mỗi bước chạy trong một giao dịch
+// riêng cùng với hàng ghi nhận nó, nên bước bị lỗi không để lại schema dở dang.
+class SchemaMigrator {
+public:
+    static bool migrate(SqliteConnection& db, std::span<const SchemaMigration> migrations) {
+        if (!db.exec("CREATE TABLE IF NOT EXISTS schema_version ("
+                     "version INTEGER PRIMARY KEY, "
+                     "description TEXT NOT NULL, "
+                     "applied_at INTEGER NOT NULL"
+                     ");")) {
+            return false;
+        }
+
+        int current = current_version(db);
+        int latest = migrations.empty() ? 0 : migrations.back().version;
+        if (current > latest) {
+            std::cerr << "Database schema version " << current << " is newer than this server (" << latest
+                      << "); continuing without migrations." << std::endl;
+            return true;
+        }
+
+        for (const SchemaMigration& migration : migrations) {
+            if (migration.version <= current) {
+                continue;
+            }
+            std::cout << "Applying schema migration " << migration.version << ": " << migration.description << std::endl;
+            if (!apply(db, migration)) {
+                std::cerr << "Schema migration " << migration.version << " failed; database left at version " << current
+                          << std::endl;
+                return false;
+            }
+            current = migration.version;
+        }
+
+        std::cout << "Database schema version: " << current << std::endl;
+        return true;
+    }
+
+    static int current_version(SqliteConnection& db) {
+        std::string version = db.query_text("SELECT MAX(version) FROM schema_version;");
+        return version.empty() ? 0 : std::stoi(version);
+    }
+
+private:
+    static bool apply(SqliteConnection& db, const SchemaMigration& migration) {
+        // IMMEDIATE giữ khóa ghi ngay từ đầu để api.py không chen vào giữa các câu lệnh của một bước.
+        if (!db.exec("BEGIN IMMEDIATE;")) {
+            return false;
+        }
+        if (db.exec(migration.sql) && record(db, migration) && db.exec("COMMIT;")) {
+            return true;
+        }
+        db.exec("ROLLBACK;");
+        return false;
+    }
+
+    static bool record(SqliteConnection& db, const SchemaMigration& migration) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db.handle(),
+                               "INSERT INTO schema_version (version, description, applied_at) "
+                               "VALUES (?, ?, CAST(strftime('%s', 'now') AS INTEGER));",
+                               -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "SQL prepare error: " << db.error_message() << std::endl;
+            return false;
+        }
+        sqlite3_bind_int(stmt, 1, migration.version);
+        sqlite3_bind_text(stmt, 2, migration.description, -1, SQLITE_STATIC);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE) {
+            std::cerr << "SQL execution error: " << db.error_message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif //DATABASE_SERVER_SCHEMA_MIGRATIONS_H
@@ -0,0 +1,55 @@
+#ifndef DATABASE_SERVER_SENSOR_DATA_H
+#define DATABASE_SERVER_SENSOR_DATA_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+class SensorData { // Định nghĩa lớp SensorData cho dữ liệu cảm biến.
+public:
+    double light_intensity{}; // Độ sáng ánh sáng.
+    double temperature{}; // Nhiệt độ.
+    double air_humidity{}; // Độ ẩm không khí.
+    double soil_humidity{}; // Độ ẩm đất.
+    std::int64_t timestamp_ms{}; // Dấu thời gian, mili giây kể từ epoch (UTC).
+    std::string prediction; // Dự đoán.
+    std::string note; // Ghi chú.
+};
+
+class DeviceReading { // Một bản ghi cảm biến kèm ID thiết bị, đơn vị xử lý của các lô bản ghi.
+public:
+    std::string device_id; // ID thiết bị.
+    SensorData sensor_data; // Dữ liệu cảm biến.
+};
+
+// Giờ địa phương (0..23) của một dấu thời gian; ngày và đêm được xét theo giờ nơi đặt máy chủ.
+inline int local_hour(std::int64_t timestamp_ms) {
+    time_t when = static_cast<time_t>(timestamp_ms / 1000);
+    tm* local = localtime(&when);
+    return local != nullptr ? local->tm_hour : 0;
+}
+
+// Buổi ngày (6h-18h) dùng ngưỡng nhiệt độ ban ngày khi dự đoán.
+inline bool is_daytime(std::int64_t timestamp_ms) {
+    int hour = local_hour(timestamp_ms);
+    return hour >= 6 && hour < 18;
+}
+
+// Mã một byte của nhãn dự đoán, cho các nơi lưu bản ghi dạng gọn; 0 là chưa gán nhãn (NULL trong sensor_data).
+inline std::uint8_t prediction_code(const std::string& prediction) {
+    if (prediction.empty()) return 0;
+    if (prediction == "good") return 1;
+    if (prediction == "bad") return 2;
+    return 255;
+}
+
+inline const char* prediction_label(std::uint8_t code) {
+    switch (code) {
+        case 0: return "";
+        case 1: return "good";
+        case 2: return "bad";
+        default: return "unknown";
+    }
+}
+
+#endif //DATABASE_SERVER_SENSOR_DATA_H
@@ -0,0 +1,131 @@
+#ifndef DATABASE_SERVER_SENSOR_ROLLUPS_H
+#define DATABASE_SERVER_SENSOR_ROLLUPS_H
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "sqlite_connection.h"
+
+// Bảng tổng hợp theo phút, giờ và ngày (UTC) cho từng thiết bị. Mỗi hàng giữ count và min/max/sum của
+// từng chỉ số; trung bình là sum / count. Được cập nhật cộng dồn trong cùng giao dịch với bản ghi gốc,
+// nên vẫn đúng sau khi bản ghi gốc đã bị xóa theo thời hạn lưu giữ.
+class SensorRollups {
+public:
+    static constexpr int kMetricCount = 4; // light, temperature, air humidity, soil humidity.
+
+    struct Level {
+        const char* table;
+        std::int64_t bucket_ms;
+    };
+
+    static constexpr std::array<Level, 3> kLevels{{
+            {"sensor_rollup_minute", 60 * 1000},
+            {"sensor_rollup_hour", 60 * 60 * 1000},
+            {"sensor_rollup_day", 24 * 60 * 60 * 1000},
+    }};
+
+    // Cộng một bản ghi vào các ô tương ứng của cả ba mức.
+    void add(const std::string& device_id, std::int64_t timestamp_ms, const double (&values)[kMetricCount]) {
+        for (std::size_t level = 0; level < kLevels.size(); ++level) {
+            std::int64_t bucket = timestamp_ms - timestamp_ms % kLevels[level].bucket_ms;
+            Bucket& target = pending_[level][{device_id, bucket}];
+            ++target.count;
+            for (int i = 0; i < kMetricCount; ++i) {
+                Metric& metric = target.metrics[i];
+                metric.min = target.count == 1 ? values[i] : std::min(metric.min, values[i]);
+                metric.max = target.count == 1 ? values[i] : std::max(metric.max, values[i]);
+                metric.sum += values[i];
+            }
+        }
+    }
+
+    // Ghi các ô đã gom vào cơ sở dữ liệu trong giao dịch đang mở của db và xóa chúng khỏi bộ nhớ.
+    // Các bản ghi cùng thiết bị và cùng ô trong một group commit chỉ tốn một câu UPSERT.
+    bool flush(SqliteConnection& db) {
+        bool ok = true;
+        for (std::size_t level = 0; level < kLevels.size(); ++level) {
+            if (pending_[level].empty()) {
+                continue;
+            }
+            Statement upsert(db, upsert_sql(level));
+            if (!upsert) {
+                ok = false;
+                continue;
+            }
+            sqlite3_stmt* stmt = upsert.get();
+            for (const auto& [key, bucket] : pending_[level]) {
+                sqlite3_bind_text(stmt, 1, key.first.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_int64(stmt, 2, key.second);
+                sqlite3_bind_int64(stmt, 3, bucket.count);
+                for (int i = 0; i < kMetricCount; ++i) {
+                    sqlite3_bind_double(stmt, 4 + i * 3, bucket.metrics[i].min);
+                    sqlite3_bind_double(stmt, 5 + i * 3, bucket.metrics[i].max);
+                    sqlite3_bind_double(stmt, 6 + i * 3, bucket.metrics[i].sum);
+                }
+                if (sqlite3_step(stmt) != SQLITE_DONE) {
+                    std::cerr << "Rollup update error: " << db.error_message() << std::endl;
+                    ok = false;
+                }
+                upsert.reset();
+            }
+        }
+        clear();
+        return ok;
+    }
+
+    void clear() {
+        for (auto& level : pending_) {
+            level.clear();
+        }
+    }
+
+private:
+    static constexpr std::array<const char*, kMetricCount> kMetricColumns = {"light", "temperature", "air_humidity",
+                                                                              "soil_humidity"};
+
+    struct Metric {
+        double min = 0;
+        double max = 0;
+        double sum = 0;
+    };
+
+    struct Bucket {
+        std::int64_t count = 0;
+        std::array<Metric, kMetricCount> metrics{};
+    };
+
+    // "INSERT ... ON CONFLICT DO UPDATE" cộng dồn vào hàng đã có của cùng thiết bị và cùng ô.
+    static const std::string& upsert_sql(std::size_t level) {
+        static const std::array<std::string, kLevels.size()> statements = [] {
+            std::array<std::string, kLevels.size()> result;
+            for (std::size_t l = 0; l < kLevels.size(); ++l) {
+                std::string columns = "device_id, bucket_start, count";
+                std::string values = "?, ?, ?";
+                std::string updates = "count = count + excluded.count";
+                for (const char* metric : kMetricColumns) {
+                    std::string m(metric);
+                    columns += ", " + m + "_min, " + m + "_max, " + m + "_sum";
+                    values += ", ?, ?, ?";
+                    updates += ", " + m + "_min = min(" + m + "_min, excluded." + m + "_min)" + ", " + m + "_max = max(" +
+                               m + "_max, excluded." + m + "_max)" + ", " + m + "_sum = " + m + "_sum + excluded." + m + "_sum";
+                }
+                result[l] = std::string("INSERT INTO ") + kLevels[l].table + " (" + columns + ") VALUES (" + values +
+                            ") ON CONFLICT (device_id, bucket_start) DO UPDATE SET " + updates;
+            }
+            return result;
+        }();
+        return statements[level];
+    }
+
+    std::array<std::map<std::pair<std::string, std::int64_t>, Bucket>, kLevels.size()> pending_;
+};
+
+#endif //DATABASE_SERVER_SENSOR_ROLLUPS_H
@@ -0,0 +1,178 @@
+#ifndef DATABASE_SERVER_SENSOR_RUNS_H
+#define DATABASE_SERVER_SENSOR_RUNS_H
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sqlite_connection.h"
+
+// Chế độ chỉ lưu thay đổi (--change-only). Hàng cuối cùng của mỗi thiết bị trong sensor_data là một "run":
+// bản ghi mới bằng nó (sai khác không quá tolerance ở từng chỉ số, cùng buổi ngày/đêm, đến không quá
+// max_gap_ms sau bản trước) không được chèn thêm mà chỉ kéo dài valid_until và tăng repeat_count của hàng đó.
+// Nơi đọc (api.py, SqliteBackend::query_range()) trải các run ra lại thành từng bản ghi, chia đều thời gian
+// giữa đầu và cuối run; giới hạn khoảng trống giữ cho run không vắt qua lúc thiết bị ngừng gửi.
+//
+// Các thay đổi trong một group commit được gom riêng và chỉ thành trạng thái chính thức sau commit(), nên
+// giao dịch bị rollback không để lại run trỏ tới hàng chưa từng được ghi. Chỉ luồng xử lý dùng.
+class SensorRuns {
+public:
+    static constexpr int kMetricCount = 4; // light, temperature, air humidity, soil humidity.
+
+    struct Run {
+        std::int64_t row_id = 0;
+        double values[kMetricCount]{};
+        bool daytime = false;
+        std::string prediction;
+        std::string note;
+        std::int64_t valid_until = 0;
+        // Phần được nối trong giao dịch đang gom, ghi ra ở flush().
+        std::int64_t pending_count = 0;
+        std::int64_t pending_from = 0;
+    };
+
+    SensorRuns(const std::array<double, kMetricCount>& tolerance, std::int64_t max_gap_ms)
+        : tolerance_(tolerance), max_gap_ms_(max_gap_ms) {}
+
+    // Nếu bản ghi lặp lại run của thiết bị thì nối nó vào run và trả về run (để lấy nhãn và ghi chú);
+    // nullptr nếu phải chèn hàng mới.
+    const Run* extend(const std::string& device_id, std::int64_t timestamp_ms, const double (&values)[kMetricCount],
+                      bool daytime) {
+        Run* run = find(device_id);
+        if (run == nullptr || run->daytime != daytime || timestamp_ms - run->valid_until > max_gap_ms_) {
+            return nullptr;
+        }
+        for (int i = 0; i < kMetricCount; ++i) {
+            if (!(std::fabs(values[i] - run->values[i]) <= tolerance_[i])) {
+                return nullptr;
+            }
+        }
+        if (run->pending_count == 0) {
+            run->pending_from = timestamp_ms;
+        }
+        ++run->pending_count;
+        run->valid_until = std::max(run->valid_until, timestamp_ms);
+        return run;
+    }
+
+    // Hàng row_id vừa được chèn cho thiết bị và trở thành run mới của nó.
+    void start(const std::string& device_id, std::int64_t row_id, std::int64_t timestamp_ms,
+               const double (&values)[kMetricCount], bool daytime, const std::string& prediction, const std::string& note) {
+        Run& run = pending_[device_id];
+        if (run.pending_count > 0) {
+            closed_.emplace_back(device_id, std::move(run)); // Phần đã nối vẫn phải được ghi ở flush().
+        }
+        run = Run{};
+        run.row_id = row_id;
+        std::copy(std::begin(values), std::end(values), run.values);
+        run.daytime = daytime;
+        run.prediction = prediction;
+        run.note = note;
+        run.valid_until = timestamp_ms;
+    }
+
+    // Ghi các run được nối vào sensor_data trong giao dịch đang mở của db. Nếu hàng của run đã bị xóa
+    // (hết hạn lưu giữ hoặc xóa qua api.py), phần mới được chèn thành một hàng riêng.
+    bool flush(SqliteConnection& db) {
+        bool ok = true;
+        for (auto& [device_id, run] : closed_) {
+            ok = write_extension(db, device_id, run) && ok;
+        }
+        for (auto& [device_id, run] : pending_) {
+            ok = write_extension(db, device_id, run) && ok;
+        }
+        return ok;
+    }
+
+    // Giao dịch đã commit: các run đang gom trở thành trạng thái chính thức.
+    void commit() {
+        for (auto& [device_id, run] : pending_) {
+            run.pending_count = 0;
+            runs_[device_id] = std::move(run);
+        }
+        pending_.clear();
+        closed_.clear();
+    }
+
+    void rollback() {
+        pending_.clear();
+        closed_.clear();
+    }
+
+private:
+    static constexpr const char* kExtendRunSql =
+            "UPDATE sensor_data SET valid_until = max(coalesce(valid_until, timestamp), ?), "
+            "repeat_count = repeat_count + ? WHERE id = ?";
+    static constexpr const char* kInsertRunSql =
+            "INSERT INTO sensor_data (device_id, light_intensity, temperature, air_humidity, soil_humidity, timestamp, "
+            "prediction, note, valid_until, repeat_count) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+    // Trạng thái của thiết bị trong giao dịch đang gom, chép từ trạng thái chính thức ở lần chạm đầu tiên.
+    Run* find(const std::string& device_id) {
+        if (auto it = pending_.find(device_id); it != pending_.end()) {
+            return &it->second;
+        }
+        auto it = runs_.find(device_id);
+        if (it == runs_.end()) {
+            return nullptr;
+        }
+        return &(pending_[device_id] = it->second);
+    }
+
+    static bool write_extension(SqliteConnection& db, const std::string& device_id, Run& run) {
+        if (run.pending_count == 0) {
+            return true;
+        }
+        Statement update(db, kExtendRunSql);
+        if (!update) {
+            return false;
+        }
+        sqlite3_bind_int64(update.get(), 1, run.valid_until);
+        sqlite3_bind_int64(update.get(), 2, run.pending_count);
+        sqlite3_bind_int64(update.get(), 3, run.row_id);
+        if (sqlite3_step(update.get()) != SQLITE_DONE) {
+            std::cerr << "Run update error: " << db.error_message() << std::endl;
+            return false;
+        }
+        return sqlite3_changes(db.handle()) != 0 || insert_run(db, device_id, run);
+    }
+
+    static bool insert_run(SqliteConnection& db, const std::string& device_id, Run& run) {
+        Statement insert(db, kInsertRunSql);
+        if (!insert) {
+            return false;
+        }
+        sqlite3_stmt* stmt = insert.get();
+        sqlite3_bind_text(stmt, 1, device_id.c_str(), -1, SQLITE_STATIC);
+        for (int i = 0; i < kMetricCount; ++i) {
+            sqlite3_bind_double(stmt, 2 + i, run.values[i]);
+        }
+        sqlite3_bind_int64(stmt, 6, run.pending_from);
+        sqlite3_bind_text(stmt, 7, run.prediction.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 8, run.note.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 9, run.valid_until);
+        sqlite3_bind_int64(stmt, 10, run.pending_count);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Run insert error: " << db.error_message() << std::endl;
+            return false;
+        }
+        run.row_id = sqlite3_last_insert_rowid(db.handle());
+        return true;
+    }
+
+    std::array<double, kMetricCount> tolerance_;
+    std::int64_t max_gap_ms_;
+    std::unordered_map<std::string, Run> runs_; // Run hiện tại của mỗi thiết bị, đã commit.
+    std::unordered_map<std::string, Run> pending_; // Run bị thay đổi trong giao dịch đang gom.
+    std::vector<std::pair<std::string, Run>> closed_; // Run đã được nối rồi bị run mới thay trong cùng giao dịch.
+};
+
+#endif //DATABASE_SERVER_SENSOR_RUNS_H
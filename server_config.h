@@ -0,0 +1,211 @@
+#ifndef DATABASE_SERVER_SERVER_CONFIG_H
+#define DATABASE_SERVER_SERVER_CONFIG_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "ingest_queue.h" // OverloadPolicy.
+#include "sqlite_connection.h" // StorageProfile.
+
+// Tầng I/O phục vụ kết nối TCP.
+enum class IoBackend {
+    Asio, // epoll qua Boost.Asio, có trên mọi nền tảng.
+    Uring, // io_uring trên Linux; cần biên dịch với ENABLE_IO_URING.
+};
+
+// Nơi lưu bản ghi cảm biến.
+enum class StorageEngine {
+    Sqlite, // Bảng sensor_data trong lora.db (đọc được từ api.py).
+    Columnar, // ColumnarStore trong columnar_dir; chỉ có trên POSIX.
+    Memory, // Chỉ trong bộ nhớ, mất khi dừng máy chủ; để đo thông lượng CPU.
+};
+
+// Cấu hình khởi động của LoRaServer. Mọi giá trị đều có mặc định và có thể ghi đè
+// bằng tham số dòng lệnh dạng --key=value.
+struct ServerConfig {
+    std::string server_ip = "192.168.172.152"; // Địa chỉ IP lắng nghe.
+    unsigned short server_port = 12345; // Cổng TCP lắng nghe.
+    std::size_t worker_threads = default_worker_threads(); // Số luồng chạy io_service.
+    std::size_t acceptor_shards = 0; // Số acceptor dùng SO_REUSEPORT, mỗi cái một io_context và một lõi; 0 = tắt.
+    unsigned short udp_port = 0; // Cổng UDP nhận dữ liệu kiểu "gửi rồi quên"; 0 = tắt.
+    unsigned int metrics_interval_seconds = 60; // Chu kỳ in số liệu thống kê; 0 = tắt.
+    std::size_t queue_capacity = 65536; // Sức chứa hàng đợi nhập liệu giữa tầng mạng và tầng xử lý.
+    std::size_t queue_high_watermark = 52428; // Độ sâu bắt đầu quá tải (80% sức chứa).
+    std::size_t queue_low_watermark = 32768; // Độ sâu thoát quá tải (50% sức chứa).
+    OverloadPolicy overload_policy = OverloadPolicy::Backpressure; // Cách xử lý bản ghi mới khi quá tải.
+    std::size_t commit_batch_rows = 512; // Số bản ghi tối đa trong một giao dịch group commit.
+    unsigned int commit_interval_ms = 5; // Thời gian tối đa gom bản ghi cho một giao dịch; 0 = chỉ gom những gì đã chờ sẵn.
+    StorageProfile storage_profile = StorageProfile::Durable; // Các PRAGMA độ bền/hiệu năng của lora.db.
+    unsigned int checkpoint_interval_seconds = 10; // Chu kỳ checkpoint WAL trên luồng nền; 0 = để luồng ghi tự checkpoint.
+    StorageEngine storage_engine = StorageEngine::Sqlite; // Nơi lưu bản ghi cảm biến; user_control luôn ở lora.db.
+    std::string columnar_dir = "lora_tsdb"; // Thư mục dữ liệu của ColumnarStore.
+    unsigned int raw_retention_days = 0; // Số ngày giữ bản ghi gốc trong sensor_data; 0 = giữ mãi. Bảng tổng hợp luôn được giữ.
+    std::size_t retention_batch_rows = 500; // Số bản ghi tối đa xóa trong một giao dịch dọn dẹp.
+    unsigned int retention_interval_seconds = 60; // Chu kỳ kiểm tra bản ghi hết hạn.
+    bool change_only = false; // Bản ghi lặp lại hàng trước của thiết bị chỉ kéo dài hàng đó (chỉ với SQLite).
+    std::array<double, 4> change_tolerance{}; // Sai khác tối đa vẫn coi là lặp lại: ánh sáng, nhiệt độ, độ ẩm không khí, độ ẩm đất.
+    unsigned int change_max_gap_seconds = 300; // Bản ghi đến sau bản trước lâu hơn mức này luôn mở hàng mới.
+    unsigned int backup_interval_seconds = 0; // Chu kỳ sao lưu lora.db trên luồng nền; 0 = tắt.
+    std::string backup_path = "backup/lora_backup.db"; // Tệp bản sao, bị thay bởi mỗi lần sao lưu thành công.
+    int backup_step_pages = 64; // Số trang chép trong một bước sao lưu.
+    unsigned int backup_pause_ms = 10; // Thời gian nghỉ giữa hai bước sao lưu.
+    std::size_t query_threads = 2; // Số luồng (và kết nối chỉ đọc tới lora.db) phục vụ yêu cầu "QUERY ..."; 0 = tắt.
+    std::size_t history_size = 360; // Số bản ghi gần nhất giữ trong bộ nhớ cho mỗi thiết bị (1 giờ với chu kỳ 10 giây).
+    unsigned int history_window_seconds = 0; // Chỉ giữ bản ghi không cũ hơn bản mới nhất quá mức này; 0 = chỉ giới hạn theo số lượng.
+    IoBackend io_backend = IoBackend::Asio; // Tầng I/O cho socket TCP và việc ghi log.txt.
+    unsigned int read_timeout_seconds = 30; // Thời gian tối đa chờ byte đầu tiên hoặc phần còn lại của một khung; 0 = tắt.
+    unsigned int idle_timeout_seconds = 600; // Thời gian tối đa không nhận được gì giữa hai khung; 0 = tắt.
+    std::size_t max_connections_per_ip = 256; // Số kết nối TCP đồng thời tối đa từ một địa chỉ IP; 0 = không giới hạn.
+
+    static std::size_t default_worker_threads() {
+        unsigned int cores = std::thread::hardware_concurrency();
+        return cores == 0 ? 4 : cores; // hardware_concurrency() có thể trả về 0.
+    }
+
+    static ServerConfig from_command_line(int argc, char* argv[]) {
+        ServerConfig config;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg(argv[i]);
+            size_t eq = arg.find('=');
+            if (arg.substr(0, 2) != "--" || eq == std::string_view::npos) {
+                std::cerr << "Ignoring unknown argument: " << arg << std::endl;
+                continue;
+            }
+
+            std::string_view key = arg.substr(2, eq - 2);
+            std::string value(arg.substr(eq + 1));
+
+            if (key == "ip") {
+                config.server_ip = value;
+            } else if (key == "port") {
+                config.server_port = static_cast<unsigned short>(std::stoul(value));
+            } else if (key == "workers") {
+                config.worker_threads = std::max<std::size_t>(1, std::stoul(value));
+            } else if (key == "acceptor-shards") {
+                config.acceptor_shards = std::stoul(value);
+            } else if (key == "udp-port") {
+                config.udp_port = static_cast<unsigned short>(std::stoul(value));
+            } else if (key == "metrics-interval") {
+                config.metrics_interval_seconds = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "queue-capacity") {
+                config.queue_capacity = std::max<std::size_t>(2, std::stoul(value));
+            } else if (key == "queue-high-watermark") {
+                config.queue_high_watermark = std::stoul(value);
+            } else if (key == "queue-low-watermark") {
+                config.queue_low_watermark = std::stoul(value);
+            } else if (key == "overload-policy") {
+                if (auto policy = parse_overload_policy(value)) {
+                    config.overload_policy = *policy;
+                } else {
+                    std::cerr << "Unknown overload policy: " << value << std::endl;
+                }
+            } else if (key == "commit-batch-rows") {
+                config.commit_batch_rows = std::max<std::size_t>(1, std::stoul(value));
+            } else if (key == "commit-interval-ms") {
+                config.commit_interval_ms = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "storage-profile") {
+                if (auto profile = parse_storage_profile(value)) {
+                    config.storage_profile = *profile;
+                } else {
+                    std::cerr << "Unknown storage profile: " << value << std::endl;
+                }
+            } else if (key == "checkpoint-interval") {
+                config.checkpoint_interval_seconds = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "storage-engine") {
+                if (value == "sqlite") {
+                    config.storage_engine = StorageEngine::Sqlite;
+                } else if (value == "columnar") {
+                    config.storage_engine = StorageEngine::Columnar;
+                } else if (value == "memory") {
+                    config.storage_engine = StorageEngine::Memory;
+                } else {
+                    std::cerr << "Unknown storage engine: " << value << std::endl;
+                }
+            } else if (key == "columnar-dir") {
+                config.columnar_dir = value;
+            } else if (key == "raw-retention-days") {
+                config.raw_retention_days = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "retention-batch-rows") {
+                config.retention_batch_rows = std::max<std::size_t>(1, std::stoul(value));
+            } else if (key == "retention-interval") {
+                config.retention_interval_seconds = std::max(1u, static_cast<unsigned int>(std::stoul(value)));
+            } else if (key == "change-only") {
+                if (value == "on") {
+                    config.change_only = true;
+                } else if (value == "off") {
+                    config.change_only = false;
+                } else {
+                    std::cerr << "Unknown change-only mode: " << value << std::endl;
+                }
+            } else if (key == "change-tolerance") {
+                if (!parse_tolerance(value, config.change_tolerance)) {
+                    std::cerr << "Invalid change tolerance (expected four numbers, e.g. 5,0.1,0.5,0.5): " << value << std::endl;
+                }
+            } else if (key == "change-max-gap") {
+                config.change_max_gap_seconds = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "backup-interval") {
+                config.backup_interval_seconds = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "backup-path") {
+                config.backup_path = value;
+            } else if (key == "backup-step-pages") {
+                config.backup_step_pages = std::max(1, std::stoi(value));
+            } else if (key == "backup-pause-ms") {
+                config.backup_pause_ms = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "query-threads") {
+                config.query_threads = std::stoul(value);
+            } else if (key == "history-size") {
+                config.history_size = std::max<std::size_t>(1, std::stoul(value));
+            } else if (key == "history-window") {
+                config.history_window_seconds = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "read-timeout") {
+                config.read_timeout_seconds = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "idle-timeout") {
+                config.idle_timeout_seconds = static_cast<unsigned int>(std::stoul(value));
+            } else if (key == "max-connections-per-ip") {
+                config.max_connections_per_ip = std::stoul(value);
+            } else if (key == "io-backend") {
+                if (value == "asio") {
+                    config.io_backend = IoBackend::Asio;
+                } else if (value == "uring") {
+                    config.io_backend = IoBackend::Uring;
+                } else {
+                    std::cerr << "Unknown I/O backend: " << value << std::endl;
+                }
+            } else {
+                std::cerr << "Ignoring unknown option: --" << key << std::endl;
+            }
+        }
+
+        return config;
+    }
+
+    // "light,temperature,air,soil"; tolerance giữ nguyên nếu chuỗi không hợp lệ.
+    static bool parse_tolerance(const std::string& value, std::array<double, 4>& tolerance) {
+        std::array<double, 4> parsed{};
+        std::size_t begin = 0;
+        for (std::size_t i = 0; i < parsed.size(); ++i) {
+            std::size_t end = value.find(',', begin);
+            if ((end == std::string::npos) != (i + 1 == parsed.size())) {
+                return false;
+            }
+            char* stop = nullptr;
+            std::string field = value.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+            parsed[i] = std::strtod(field.c_str(), &stop);
+            if (field.empty() || *stop != '\0' || !(parsed[i] >= 0)) {
+                return false;
+            }
+            begin = end + 1;
+        }
+        tolerance = parsed;
+        return true;
+    }
+};
+
+#endif //DATABASE_SERVER_SERVER_CONFIG_H
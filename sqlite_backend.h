@@ -0,0 +1,565 @@
+#ifndef DATABASE_SERVER_SQLITE_BACKEND_H
+#define DATABASE_SERVER_SQLITE_BACKEND_H
+
+#include <sqlite3.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "online_backup.h" // Sao lưu lora.db khi đang ghi.
+#include "schema_migrations.h" // Nâng cấp schema lora.db theo phiên bản.
+#include "sensor_rollups.h" // Bảng tổng hợp theo phút/giờ/ngày.
+#include "sensor_runs.h" // Chế độ chỉ lưu thay đổi.
+#include "server_config.h"
+#include "sqlite_connection.h"
+#include "sqlite_read_pool.h"
+#include "storage_backend.h"
+
+// Bản ghi cảm biến trong bảng sensor_data của lora.db, đọc được từ api.py. Một kết nối ghi duy nhất dùng
+// trên luồng xử lý; luồng checkpoint WAL, luồng dọn dẹp theo thời hạn lưu giữ và luồng sao lưu có kết nối riêng.
+// query_range() đọc qua nhóm kết nối chỉ đọc của máy chủ (set_read_pool()).
+// Bảng tổng hợp và các run của --change-only được cập nhật trong cùng giao dịch với bản ghi gốc.
+class SqliteBackend : public StorageBackend {
+public:
+    static constexpr const char* kDatabasePath = "lora.db";
+
+    explicit SqliteBackend(const ServerConfig& config, const std::string& path = kDatabasePath)
+        : config_(config), db_(path), checkpoint_db_(path), retention_db_(path),
+          backup_(path, config.backup_path, config.backup_step_pages, std::chrono::milliseconds(config.backup_pause_ms)) {}
+
+    // Nâng cấp schema của lora.db khi bản ghi cảm biến nằm ở backend khác: user_control luôn ở đây.
+    static bool migrate_schema(const std::string& path = kDatabasePath) {
+        SqliteConnection db(path);
+        if (!db.open()) {
+            std::cerr << "Không thể mở cơ sở dữ liệu: " << db.error_message() << std::endl;
+            return false;
+        }
+        return SchemaMigrator::migrate(db, kSchemaMigrations);
+    }
+
+    const char* name() const override { return "sqlite"; }
+
+    // Mở kết nối ghi dùng suốt vòng đời máy chủ và nâng cấp schema tới phiên bản mới nhất.
+    bool open() override {
+        if (!db_.open()) {
+            std::cerr << "Không thể mở cơ sở dữ liệu: " << db_.error_message() << std::endl; // In lỗi nếu không thể mở cơ sở dữ liệu.
+            return false;
+        }
+        configure_storage();
+        SchemaMigrator::migrate(db_, kSchemaMigrations); // Lỗi được in ra bên trong; máy chủ vẫn chạy với schema hiện có.
+        if (config_.change_only) {
+            enable_change_only();
+        }
+
+        // Biên dịch sẵn các câu lệnh dùng cho mỗi bản ghi.
+        db_.prepare(kSelectTrainingDataSql);
+        db_.prepare(kInsertSensorDataSql);
+        return true;
+    }
+
+    void start_background(std::vector<std::thread>& workers) override {
+        if (background_checkpoints_) {
+            workers.emplace_back([this]() { run_checkpointer(); });
+        }
+        if (config_.raw_retention_days > 0) {
+            workers.emplace_back([this]() { run_retention(); });
+        }
+        if (config_.backup_interval_seconds > 0) {
+            std::cout << "Online backup: every " << config_.backup_interval_seconds << "s to " << config_.backup_path
+                      << ", " << config_.backup_step_pages << " pages per step, " << config_.backup_pause_ms
+                      << " ms between steps" << std::endl;
+            workers.emplace_back([this]() { run_backup(); });
+        }
+    }
+
+    std::size_t insert_batch(std::vector<DeviceReading>& batch, const Annotate& annotate, std::vector<bool>* stored_rows,
+                             std::vector<bool>* repeated_rows) override {
+        if (stored_rows != nullptr) {
+            stored_rows->assign(batch.size(), false);
+        }
+        if (repeated_rows != nullptr) {
+            repeated_rows->assign(batch.size(), false);
+        }
+
+        // Cập nhật cơ sở dữ liệu qua kết nối và câu lệnh INSERT đã biên dịch sẵn.
+        Statement insert(db_, kInsertSensorDataSql);
+        if (!insert) {
+            return 0;
+        }
+        sqlite3_stmt* stmt = insert.get();
+        sqlite3* db = db_.handle();
+
+        // Cả lô chỉ tốn một lần commit. Không mở được giao dịch thì không chèn gì: nếu không mỗi INSERT sẽ tự
+        // commit riêng, COMMIT cuối lỗi và các hàng đã ghi thật lại bị báo là chưa lưu.
+        if (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            std::cerr << "SQL begin error: " << sqlite3_errmsg(db) << std::endl;
+            return 0;
+        }
+
+        std::size_t stored = 0;
+        std::size_t collapsed = 0;
+
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            DeviceReading& reading = batch[i];
+            SensorData& sensor_data = reading.sensor_data;
+            const double values[] = {sensor_data.light_intensity, sensor_data.temperature, sensor_data.air_humidity,
+                                     sensor_data.soil_humidity};
+            // Dự đoán chỉ phụ thuộc vào các chỉ số và buổi ngày/đêm, nên bản ghi lặp lại dùng lại nhãn của run.
+            bool daytime = runs_ && is_daytime(sensor_data.timestamp_ms);
+            if (runs_) {
+                if (const SensorRuns::Run* run = runs_->extend(reading.device_id, sensor_data.timestamp_ms, values, daytime)) {
+                    sensor_data.prediction = run->prediction;
+                    sensor_data.note = run->note;
+                    rollups_.add(reading.device_id, sensor_data.timestamp_ms, values);
+                    ++stored;
+                    ++collapsed;
+                    if (stored_rows != nullptr) {
+                        (*stored_rows)[i] = true;
+                    }
+                    if (repeated_rows != nullptr) {
+                        (*repeated_rows)[i] = true;
+                    }
+                    continue;
+                }
+            }
+            annotate(sensor_data);
+
+            // Gắn giá trị vào câu lệnh SQL.
+            sqlite3_bind_text(stmt, 1, reading.device_id.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_double(stmt, 2, sensor_data.light_intensity);
+            sqlite3_bind_double(stmt, 3, sensor_data.temperature);
+            sqlite3_bind_double(stmt, 4, sensor_data.air_humidity);
+            sqlite3_bind_double(stmt, 5, sensor_data.soil_humidity);
+            sqlite3_bind_int64(stmt, 6, sensor_data.timestamp_ms);
+            sqlite3_bind_text(stmt, 7, sensor_data.prediction.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 8, sensor_data.note.c_str(), -1, SQLITE_STATIC);
+
+            int rc = sqlite3_step(stmt);
+            if (rc != SQLITE_DONE) {
+                std::cerr << "SQL execution error: " << sqlite3_errmsg(db) << std::endl;
+            } else {
+                ++stored;
+                if (stored_rows != nullptr) {
+                    (*stored_rows)[i] = true;
+                }
+                rollups_.add(reading.device_id, sensor_data.timestamp_ms, values);
+                if (runs_) {
+                    runs_->start(reading.device_id, sqlite3_last_insert_rowid(db), sensor_data.timestamp_ms, values, daytime,
+                                 sensor_data.prediction, sensor_data.note);
+                }
+            }
+            insert.reset(); // Dùng lại câu lệnh đã biên dịch cho bản ghi tiếp theo.
+        }
+
+        // Bảng tổng hợp và các run được cập nhật trong cùng giao dịch: hoặc cả bản ghi gốc lẫn tổng hợp được
+        // commit, hoặc không.
+        bool runs_updated = !runs_ || runs_->flush(db_);
+        bool rollups_updated = rollups_.flush(db_);
+        bool updated = runs_updated && rollups_updated;
+        int rc = updated ? sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) : SQLITE_ERROR;
+        if (rc != SQLITE_OK) {
+            if (updated) {
+                std::cerr << "SQL commit error: " << sqlite3_errmsg(db) << std::endl;
+            }
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            if (runs_) {
+                runs_->rollback();
+            }
+            stored = 0;
+            if (stored_rows != nullptr) {
+                stored_rows->assign(batch.size(), false);
+            }
+            return stored;
+        }
+        if (runs_) {
+            runs_->commit();
+            collapsed_readings_.fetch_add(collapsed, std::memory_order_relaxed);
+        }
+        return stored;
+    }
+
+    // Một run của --change-only được tính repeat_count lần, như khi từng bản ghi có hàng riêng.
+    void scan_training(const std::function<void(double)>& fn) override {
+        Statement stmt(db_, kSelectTrainingDataSql); // Câu lệnh đã biên dịch sẵn, được reset khi ra khỏi hàm.
+        if (!stmt) {
+            return;
+        }
+        while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+            double temperature = sqlite3_column_double(stmt.get(), 0); // Lấy giá trị nhiệt độ từ cột 0.
+            for (std::int64_t i = sqlite3_column_int64(stmt.get(), 1); i > 0; --i) {
+                fn(temperature);
+            }
+        }
+    }
+
+    // Các luồng truy vấn đọc qua pool, không qua kết nối ghi; pool phải còn sống khi còn truy vấn.
+    void set_read_pool(SqliteReadPool* pool) { read_pool_ = pool; }
+
+    // Với --change-only, mỗi run được trải ra thành repeat_count bản ghi như expand_runs() của api.py, kể cả
+    // run bắt đầu trước from_ms mà còn kéo dài vào khoảng; limit tính theo bản ghi đã trải.
+    // Trả về false khi chưa có nhóm kết nối chỉ đọc.
+    bool query_range(const std::string& device_id, std::int64_t from_ms, std::int64_t to_ms, std::size_t limit,
+                     const std::function<void(const SensorData&)>& fn) override {
+        if (read_pool_ == nullptr) {
+            return false;
+        }
+        bool ok = false;
+        read_pool_->read([&](SqliteConnection& db) {
+            Statement stmt(db, kSelectRangeSql);
+            if (!stmt) {
+                return;
+            }
+            sqlite3_bind_text(stmt.get(), 1, device_id.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt.get(), 2, from_ms);
+            sqlite3_bind_int64(stmt.get(), 3, to_ms);
+            int rc = SQLITE_DONE;
+            std::size_t rows = 0;
+            SensorData data;
+            while (rows < limit && (rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+                data.light_intensity = sqlite3_column_double(stmt.get(), 0);
+                data.temperature = sqlite3_column_double(stmt.get(), 1);
+                data.air_humidity = sqlite3_column_double(stmt.get(), 2);
+                data.soil_humidity = sqlite3_column_double(stmt.get(), 3);
+                data.prediction = column_text(stmt.get(), 5);
+                data.note = column_text(stmt.get(), 6);
+                std::int64_t start = sqlite3_column_int64(stmt.get(), 4);
+                bool has_end = sqlite3_column_type(stmt.get(), 7) != SQLITE_NULL;
+                std::int64_t end = sqlite3_column_int64(stmt.get(), 7);
+                std::int64_t count = std::max<std::int64_t>(1, sqlite3_column_int64(stmt.get(), 8));
+                // Bản đầu ở timestamp, bản cuối ở valid_until, các bản ở giữa chia đều.
+                for (std::int64_t k = 0; k < count && rows < limit; ++k) {
+                    data.timestamp_ms = k == 0 || !has_end ? start : start + (end - start) * k / (count - 1);
+                    if (data.timestamp_ms > to_ms) {
+                        break;
+                    }
+                    if (data.timestamp_ms >= from_ms) {
+                        fn(data);
+                        ++rows;
+                    }
+                }
+            }
+            if (rows == limit) {
+                rc = SQLITE_DONE; // Đủ limit bản ghi: dừng sớm không phải lỗi.
+            }
+            ok = rc == SQLITE_DONE;
+        });
+        return ok;
+    }
+
+    void report_metrics(std::ostream& out) const override {
+        if (background_checkpoints_) {
+            out << "[metrics] storage checkpoints=" << checkpoints_.load(std::memory_order_relaxed)
+                << " wal_frames=" << wal_frames_.load(std::memory_order_relaxed)
+                << " checkpointed_frames=" << checkpointed_frames_.load(std::memory_order_relaxed) << "\n";
+        }
+        if (runs_) {
+            out << "[metrics] change_only collapsed=" << collapsed_readings_.load(std::memory_order_relaxed) << "\n";
+        }
+        if (config_.raw_retention_days > 0) {
+            out << "[metrics] retention pruned=" << pruned_rows_.load(std::memory_order_relaxed) << "\n";
+        }
+        if (config_.backup_interval_seconds > 0) {
+            out << "[metrics] backup runs=" << backup_.backups() << " failed=" << backup_.failures()
+                << " last_ms=" << backup_.last_duration_ms() << " last_bytes=" << backup_.last_bytes();
+            if (backup_.running()) {
+                out << " in_progress=" << backup_.pages_copied() << "/" << backup_.pages_total() << " pages";
+            }
+            out << "\n";
+        }
+    }
+
+private:
+    static constexpr const char* kSelectTrainingDataSql =
+            "SELECT temperature, repeat_count FROM sensor_data WHERE prediction IS NOT NULL;";
+    // Run còn được kéo dài (valid_until mới) chưa hết hạn dù bắt đầu từ lâu.
+    static constexpr const char* kPruneSensorDataSql =
+            "DELETE FROM sensor_data WHERE id IN (SELECT id FROM sensor_data WHERE timestamp < ?1 "
+            "AND coalesce(valid_until, timestamp) < ?1 ORDER BY timestamp LIMIT ?2)";
+    static constexpr const char* kInsertSensorDataSql =
+            "INSERT INTO sensor_data (device_id, light_intensity, temperature, air_humidity, soil_humidity, timestamp, prediction, note) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+    // Các run có coalesce(valid_until, timestamp) >= from và timestamp <= to. Run của một thiết bị không chồng
+    // nhau, nên trong các run bắt đầu trước from chỉ run gần nhất có thể còn kéo dài vào khoảng; tách nó ra
+    // để cả hai nhánh đều là một lần tìm trên chỉ mục (device_id, timestamp).
+    static constexpr const char* kSelectRangeSql =
+            "SELECT * FROM (SELECT light_intensity, temperature, air_humidity, soil_humidity, timestamp, prediction, note, "
+            "valid_until, repeat_count FROM sensor_data WHERE device_id = ?1 AND timestamp < ?2 "
+            "ORDER BY timestamp DESC LIMIT 1) WHERE coalesce(valid_until, timestamp) >= ?2 "
+            "UNION ALL SELECT light_intensity, temperature, air_humidity, soil_humidity, timestamp, prediction, note, "
+            "valid_until, repeat_count FROM sensor_data WHERE device_id = ?1 AND timestamp BETWEEN ?2 AND ?3 "
+            "ORDER BY timestamp";
+
+    // Các bước schema của lora.db, theo thứ tự. Chỉ thêm bước mới ở cuối; không sửa bước đã phát hành.
+    static constexpr std::array<SchemaMigration, 5> kSchemaMigrations{{
+            {1, "sensor_data and user_control tables",
+             // IF NOT EXISTS: tệp tạo bởi phiên bản trước khi có schema_version đã có sẵn hai bảng này.
+             "CREATE TABLE IF NOT EXISTS sensor_data ("
+             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "device_id TEXT, "
+             "light_intensity REAL, "
+             "temperature REAL, "
+             "air_humidity REAL, "
+             "soil_humidity REAL, "
+             "prediction TEXT, "
+             "timestamp TEXT, "
+             "note TEXT"
+             ");"
+             "CREATE TABLE IF NOT EXISTS user_control ("
+             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "device_id TEXT, "
+             "command TEXT, "
+             "timestamp TEXT"
+             ");"},
+            {2, "indexes for per-device time queries and labelled training rows",
+             // Bảng điều khiển lọc theo thiết bị và khoảng thời gian; test.py lấy lệnh mới nhất của từng thiết bị.
+             "CREATE INDEX IF NOT EXISTS sensor_data_device_time ON sensor_data (device_id, timestamp);"
+             "CREATE INDEX IF NOT EXISTS user_control_device_time ON user_control (device_id, timestamp);"
+             // Chỉ mục một phần và bao phủ cho get_training_data: chỉ chứa hàng đã gán nhãn. prediction phải có
+             // trong khóa thì SQLite mới kiểm tra được điều kiện mà không đọc bảng.
+             "CREATE INDEX IF NOT EXISTS sensor_data_labelled ON sensor_data (temperature, prediction) "
+             "WHERE prediction IS NOT NULL;"},
+            {3, "integer epoch-millisecond timestamps",
+             // Cột TEXT sẽ đổi số nguyên thành chuỗi khi ghi, nên phải dựng lại bảng với cột INTEGER.
+             // Chuỗi cũ của sensor_data là giờ địa phương của máy chủ ("%Y-%m-%d %H:%M:%S"); 'utc' đổi chúng
+             // về UTC. Chuỗi của user_control do api.py ghi theo giờ UTC+7 (API_TIMEZONE), bất kể múi giờ của
+             // máy chủ, nên được đổi bằng độ lệch cố định '-7 hours'.
+             // Chuỗi không đọc được trở thành NULL thay vì làm hỏng cả bước nâng cấp.
+             "CREATE TABLE sensor_data_v3 ("
+             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "device_id TEXT, "
+             "light_intensity REAL, "
+             "temperature REAL, "
+             "air_humidity REAL, "
+             "soil_humidity REAL, "
+             "prediction TEXT, "
+             "timestamp INTEGER, "
+             "note TEXT"
+             ");"
+             "INSERT INTO sensor_data_v3 "
+             "SELECT id, device_id, light_intensity, temperature, air_humidity, soil_humidity, prediction, "
+             "CASE WHEN typeof(timestamp) = 'text' "
+             "THEN CAST(round((julianday(timestamp, 'utc') - 2440587.5) * 86400000.0) AS INTEGER) "
+             "ELSE timestamp END, "
+             "note FROM sensor_data;"
+             "DROP TABLE sensor_data;"
+             "ALTER TABLE sensor_data_v3 RENAME TO sensor_data;"
+             "CREATE TABLE user_control_v3 ("
+             "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+             "device_id TEXT, "
+             "command TEXT, "
+             "timestamp INTEGER"
+             ");"
+             "INSERT INTO user_control_v3 "
+             "SELECT id, device_id, command, "
+             "CASE WHEN typeof(timestamp) = 'text' "
+             "THEN CAST(round((julianday(timestamp, '-7 hours') - 2440587.5) * 86400000.0) AS INTEGER) "
+             "ELSE timestamp END "
+             "FROM user_control;"
+             "DROP TABLE user_control;"
+             "ALTER TABLE user_control_v3 RENAME TO user_control;"
+             // Chỉ mục bị xóa cùng bảng cũ.
+             "CREATE INDEX sensor_data_device_time ON sensor_data (device_id, timestamp);"
+             "CREATE INDEX user_control_device_time ON user_control (device_id, timestamp);"
+             "CREATE INDEX sensor_data_labelled ON sensor_data (temperature, prediction) WHERE prediction IS NOT NULL;"},
+            {4, "minute/hour/day rollups and a time index for retention",
+             "CREATE TABLE sensor_rollup_minute ("
+             "device_id TEXT NOT NULL, "
+             "bucket_start INTEGER NOT NULL, "
+             "count INTEGER NOT NULL, "
+             "light_min REAL, light_max REAL, light_sum REAL, "
+             "temperature_min REAL, temperature_max REAL, temperature_sum REAL, "
+             "air_humidity_min REAL, air_humidity_max REAL, air_humidity_sum REAL, "
+             "soil_humidity_min REAL, soil_humidity_max REAL, soil_humidity_sum REAL, "
+             "PRIMARY KEY (device_id, bucket_start)"
+             ") WITHOUT ROWID;"
+             "CREATE TABLE sensor_rollup_hour ("
+             "device_id TEXT NOT NULL, "
+             "bucket_start INTEGER NOT NULL, "
+             "count INTEGER NOT NULL, "
+             "light_min REAL, light_max REAL, light_sum REAL, "
+             "temperature_min REAL, temperature_max REAL, temperature_sum REAL, "
+             "air_humidity_min REAL, air_humidity_max REAL, air_humidity_sum REAL, "
+             "soil_humidity_min REAL, soil_humidity_max REAL, soil_humidity_sum REAL, "
+             "PRIMARY KEY (device_id, bucket_start)"
+             ") WITHOUT ROWID;"
+             "CREATE TABLE sensor_rollup_day ("
+             "device_id TEXT NOT NULL, "
+             "bucket_start INTEGER NOT NULL, "
+             "count INTEGER NOT NULL, "
+             "light_min REAL, light_max REAL, light_sum REAL, "
+             "temperature_min REAL, temperature_max REAL, temperature_sum REAL, "
+             "air_humidity_min REAL, air_humidity_max REAL, air_humidity_sum REAL, "
+             "soil_humidity_min REAL, soil_humidity_max REAL, soil_humidity_sum REAL, "
+             "PRIMARY KEY (device_id, bucket_start)"
+             ") WITHOUT ROWID;"
+             // Tổng hợp lại các bản ghi đã có trước khi bảng tổng hợp tồn tại.
+             "INSERT INTO sensor_rollup_minute "
+             "SELECT device_id, timestamp - timestamp % 60000, count(*), "
+             "min(light_intensity), max(light_intensity), sum(light_intensity), "
+             "min(temperature), max(temperature), sum(temperature), "
+             "min(air_humidity), max(air_humidity), sum(air_humidity), "
+             "min(soil_humidity), max(soil_humidity), sum(soil_humidity) "
+             "FROM sensor_data WHERE device_id IS NOT NULL AND timestamp IS NOT NULL GROUP BY 1, 2;"
+             "INSERT INTO sensor_rollup_hour "
+             "SELECT device_id, timestamp - timestamp % 3600000, count(*), "
+             "min(light_intensity), max(light_intensity), sum(light_intensity), "
+             "min(temperature), max(temperature), sum(temperature), "
+             "min(air_humidity), max(air_humidity), sum(air_humidity), "
+             "min(soil_humidity), max(soil_humidity), sum(soil_humidity) "
+             "FROM sensor_data WHERE device_id IS NOT NULL AND timestamp IS NOT NULL GROUP BY 1, 2;"
+             "INSERT INTO sensor_rollup_day "
+             "SELECT device_id, timestamp - timestamp % 86400000, count(*), "
+             "min(light_intensity), max(light_intensity), sum(light_intensity), "
+             "min(temperature), max(temperature), sum(temperature), "
+             "min(air_humidity), max(air_humidity), sum(air_humidity), "
+             "min(soil_humidity), max(soil_humidity), sum(soil_humidity) "
+             "FROM sensor_data WHERE device_id IS NOT NULL AND timestamp IS NOT NULL GROUP BY 1, 2;"
+             // Dọn bản ghi cũ theo thời hạn lưu giữ cần tìm theo thời gian trên mọi thiết bị.
+             "CREATE INDEX sensor_data_time ON sensor_data (timestamp);"},
+            {5, "run-length columns for change-only storage",
+             // Hàng thường có valid_until NULL và repeat_count 1. Một run là repeat_count bản ghi giống nhau,
+             // bản đầu ở timestamp và bản cuối ở valid_until; các bản ở giữa cách đều nhau. Người đọc (api.py,
+             // query_range()) trải run ra sau khi đã lọc theo khoảng thời gian.
+             "ALTER TABLE sensor_data ADD COLUMN valid_until INTEGER;"
+             "ALTER TABLE sensor_data ADD COLUMN repeat_count INTEGER NOT NULL DEFAULT 1;"
+             // scan_training() đếm mỗi run repeat_count lần; thêm cột vào chỉ mục để nó vẫn chỉ đọc chỉ mục.
+             "DROP INDEX sensor_data_labelled;"
+             "CREATE INDEX sensor_data_labelled ON sensor_data (temperature, prediction, repeat_count) "
+             "WHERE prediction IS NOT NULL;"},
+    }};
+
+    static std::string column_text(sqlite3_stmt* stmt, int column) {
+        const unsigned char* text = sqlite3_column_text(stmt, column);
+        return text != nullptr ? reinterpret_cast<const char*>(text) : "";
+    }
+
+    // Áp dụng hồ sơ lưu trữ cho kết nối ghi và in cấu hình thực sự đang dùng.
+    void configure_storage() {
+        StorageSettings settings = StorageSettings::for_profile(config_.storage_profile);
+        std::string journal_mode = db_.configure(settings);
+
+        // Ở chế độ WAL, checkpoint chép các trang từ WAL về tệp chính và có thể mất hàng trăm mili giây;
+        // chuyển việc này sang luồng nền để luồng ghi không dừng giữa các group commit.
+        background_checkpoints_ = journal_mode == "wal" && config_.checkpoint_interval_seconds > 0;
+        if (background_checkpoints_) {
+            db_.exec("PRAGMA wal_autocheckpoint=0;");
+        }
+
+        std::cout << "Storage profile: " << storage_profile_name(config_.storage_profile)
+                  << " (journal_mode=" << journal_mode << ", synchronous=" << settings.synchronous
+                  << ", mmap_size=" << db_.query_text("PRAGMA mmap_size;")
+                  << ", cache_size=" << db_.query_text("PRAGMA cache_size;")
+                  << ", wal_autocheckpoint=" << db_.query_text("PRAGMA wal_autocheckpoint;") << ")";
+        if (background_checkpoints_) {
+            std::cout << ", background checkpoint every " << config_.checkpoint_interval_seconds << "s";
+        }
+        std::cout << std::endl;
+        if (journal_mode != "wal") {
+            std::cerr << "Không chuyển được lora.db sang WAL; đọc và ghi đồng thời sẽ chặn lẫn nhau." << std::endl;
+        }
+    }
+
+    void enable_change_only() {
+        runs_ = std::make_unique<SensorRuns>(config_.change_tolerance,
+                                             static_cast<std::int64_t>(config_.change_max_gap_seconds) * 1000);
+        const auto& t = config_.change_tolerance;
+        std::cout << "Change-only storage: on (tolerance light=" << t[0] << ", temperature=" << t[1]
+                  << ", air_humidity=" << t[2] << ", soil_humidity=" << t[3] << "; max gap "
+                  << config_.change_max_gap_seconds << "s)" << std::endl;
+    }
+
+    // Luồng nền checkpoint WAL định kỳ. PASSIVE không chờ người đọc nào: trang còn đang được api.py đọc
+    // sẽ được chép ở lần sau, và WAL chỉ quay về đầu khi mọi trang đã được chép.
+    void run_checkpointer() {
+        if (!checkpoint_db_.open()) {
+            std::cerr << "Không thể mở kết nối checkpoint: " << checkpoint_db_.error_message() << std::endl;
+            return;
+        }
+        checkpoint_db_.query_text("PRAGMA journal_mode;"); // Kết nối chỉ nhận ra WAL sau lần đọc đầu tiên.
+
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::seconds(config_.checkpoint_interval_seconds));
+
+            int wal_frames = 0;
+            int checkpointed_frames = 0;
+            int rc = sqlite3_wal_checkpoint_v2(checkpoint_db_.handle(), nullptr, SQLITE_CHECKPOINT_PASSIVE,
+                                               &wal_frames, &checkpointed_frames);
+            if (rc != SQLITE_OK) {
+                std::cerr << "WAL checkpoint error: " << checkpoint_db_.error_message() << std::endl;
+                continue;
+            }
+            checkpoints_.fetch_add(1, std::memory_order_relaxed);
+            wal_frames_.store(wal_frames, std::memory_order_relaxed);
+            checkpointed_frames_.store(checkpointed_frames, std::memory_order_relaxed);
+        }
+    }
+
+    // Luồng nền xóa bản ghi gốc cũ hơn thời hạn lưu giữ. Mỗi giao dịch chỉ xóa retention_batch_rows bản ghi
+    // rồi nghỉ một chút, nên luồng ghi không bao giờ phải chờ khóa ghi lâu hơn một lô nhỏ.
+    void run_retention() {
+        static constexpr auto kPauseBetweenBatches = std::chrono::milliseconds(20);
+        const std::int64_t retention_ms = static_cast<std::int64_t>(config_.raw_retention_days) * 24 * 60 * 60 * 1000;
+
+        if (!retention_db_.open()) {
+            std::cerr << "Không thể mở kết nối dọn dẹp: " << retention_db_.error_message() << std::endl;
+            return;
+        }
+
+        for (;;) {
+            const std::int64_t cutoff = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count() - retention_ms;
+            for (;;) {
+                Statement prune(retention_db_, kPruneSensorDataSql);
+                if (!prune) {
+                    return;
+                }
+                sqlite3_bind_int64(prune.get(), 1, cutoff);
+                sqlite3_bind_int64(prune.get(), 2, static_cast<sqlite3_int64>(config_.retention_batch_rows));
+                if (sqlite3_step(prune.get()) != SQLITE_DONE) {
+                    std::cerr << "Retention prune error: " << retention_db_.error_message() << std::endl;
+                    break;
+                }
+                auto deleted = static_cast<std::size_t>(sqlite3_changes(retention_db_.handle()));
+                pruned_rows_.fetch_add(deleted, std::memory_order_relaxed);
+                if (deleted < config_.retention_batch_rows) {
+                    break; // Đã hết bản ghi hết hạn.
+                }
+                std::this_thread::sleep_for(kPauseBetweenBatches);
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(config_.retention_interval_seconds));
+        }
+    }
+
+    // Luồng nền sao lưu lora.db định kỳ; lần đầu sau một chu kỳ.
+    void run_backup() {
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::seconds(config_.backup_interval_seconds));
+            backup_.run(); // Lỗi được in ra bên trong; lần sau thử lại.
+        }
+    }
+
+    const ServerConfig config_;
+    SqliteConnection db_; // Kết nối ghi duy nhất; chỉ open() và luồng xử lý dùng.
+    SqliteConnection checkpoint_db_; // Kết nối riêng của luồng checkpoint.
+    SqliteConnection retention_db_; // Kết nối riêng của luồng dọn dẹp theo thời hạn lưu giữ.
+    SqliteReadPool* read_pool_ = nullptr; // Của máy chủ; nullptr nếu tắt truy vấn.
+    bool background_checkpoints_ = false; // WAL được checkpoint trên luồng nền thay vì trên luồng ghi.
+    std::atomic<std::uint64_t> checkpoints_{0}; // Số lần checkpoint nền thành công.
+    std::atomic<int> wal_frames_{-1}; // Số trang trong WAL ở lần checkpoint gần nhất; -1 = chưa có.
+    std::atomic<int> checkpointed_frames_{-1}; // Số trang trong số đó đã được chép về tệp cơ sở dữ liệu.
+    SensorRollups rollups_; // Các ô tổng hợp của group commit đang ghi; chỉ luồng xử lý dùng.
+    std::unique_ptr<SensorRuns> runs_; // Khác nullptr khi chạy --change-only=on; chỉ luồng xử lý dùng.
+    std::atomic<std::uint64_t> collapsed_readings_{0}; // Số bản ghi chỉ kéo dài một run thay vì thành hàng mới.
+    std::atomic<std::uint64_t> pruned_rows_{0}; // Số bản ghi gốc đã xóa vì hết hạn.
+    OnlineBackup backup_; // Dùng trên luồng sao lưu khi backup_interval_seconds > 0.
+};
+
+#endif //DATABASE_SERVER_SQLITE_BACKEND_H
@@ -0,0 +1,202 @@
+#ifndef DATABASE_SERVER_SQLITE_CONNECTION_H
+#define DATABASE_SERVER_SQLITE_CONNECTION_H
+
+#include <sqlite3.h>
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+// Hồ sơ lưu trữ: đánh đổi giữa độ bền khi mất điện và tốc độ ghi. Mọi hồ sơ đều dùng WAL để api.py và
+// test.py đọc song song với luồng ghi thay vì chặn lẫn nhau.
+enum class StorageProfile {
+    Durable, // synchronous=FULL: giao dịch đã commit (và đã ACK) không mất khi mất điện.
+    Balanced, // synchronous=NORMAL: không hỏng dữ liệu, nhưng có thể mất vài giao dịch cuối khi mất điện.
+    Throughput, // synchronous=OFF: nhanh nhất; mất điện có thể làm hỏng cơ sở dữ liệu.
+};
+
+inline std::optional<StorageProfile> parse_storage_profile(std::string_view name) {
+    if (name == "durable") return StorageProfile::Durable;
+    if (name == "balanced") return StorageProfile::Balanced;
+    if (name == "throughput") return StorageProfile::Throughput;
+    return std::nullopt;
+}
+
+inline const char* storage_profile_name(StorageProfile profile) {
+    switch (profile) {
+        case StorageProfile::Durable: return "durable";
+        case StorageProfile::Balanced: return "balanced";
+        default: return "throughput";
+    }
+}
+
+// Các PRAGMA tương ứng với một hồ sơ lưu trữ.
+struct StorageSettings {
+    const char* journal_mode;
+    const char* synchronous;
+    std::int64_t mmap_size; // Byte; 0 = đọc qua read() thay vì mmap.
+    int cache_size; // Số âm là KiB, theo quy ước của SQLite.
+    int wal_autocheckpoint; // Số trang WAL trước khi luồng ghi tự checkpoint; 0 = tắt.
+
+    static StorageSettings for_profile(StorageProfile profile) {
+        switch (profile) {
+            case StorageProfile::Durable: return {"WAL", "FULL", 64ll << 20, -8192, 1000};
+            case StorageProfile::Balanced: return {"WAL", "NORMAL", 256ll << 20, -32768, 1000};
+            default: return {"WAL", "OFF", 1ll << 30, -131072, 10000};
+        }
+    }
+};
+
+// Một kết nối SQLite mở một lần và dùng suốt vòng đời máy chủ, cùng bộ nhớ đệm các câu lệnh đã biên dịch.
+// Việc mở cơ sở dữ liệu và đọc schema chỉ xảy ra một lần thay vì ở mỗi bản ghi.
+// Không được dùng đồng thời từ nhiều luồng (mở với SQLITE_OPEN_NOMUTEX).
+class SqliteConnection {
+public:
+    // read_only: mở với SQLITE_OPEN_READONLY, không tạo tệp nếu chưa có (dùng cho SqliteReadPool).
+    explicit SqliteConnection(std::string path, bool read_only = false) : path_(std::move(path)), read_only_(read_only) {}
+
+    ~SqliteConnection() {
+        close();
+    }
+
+    SqliteConnection(const SqliteConnection&) = delete;
+    SqliteConnection& operator=(const SqliteConnection&) = delete;
+
+    // Mở (hoặc tạo) cơ sở dữ liệu. Trả về false và in lỗi nếu không mở được.
+    bool open() {
+        if (db_ != nullptr) {
+            return true;
+        }
+        int flags = (read_only_ ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) | SQLITE_OPEN_NOMUTEX;
+        int rc = sqlite3_open_v2(path_.c_str(), &db_, flags, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Cannot open database " << path_ << ": " << sqlite3_errmsg(db_) << std::endl;
+            sqlite3_close(db_);
+            db_ = nullptr;
+            return false;
+        }
+        // api.py và các công cụ khác đọc cùng tệp: chờ khóa thay vì thất bại ngay với SQLITE_BUSY.
+        sqlite3_busy_timeout(db_, kBusyTimeoutMs);
+        return true;
+    }
+
+    void close() {
+        for (auto& [sql, stmt] : statements_) {
+            sqlite3_finalize(stmt);
+        }
+        statements_.clear();
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+
+    bool is_open() const { return db_ != nullptr; }
+    sqlite3* handle() const { return db_; }
+    const char* error_message() const { return db_ != nullptr ? sqlite3_errmsg(db_) : "database is not open"; }
+
+    // Chạy một hoặc nhiều câu lệnh không trả về dữ liệu. In lỗi và trả về false nếu thất bại.
+    bool exec(const char* sql) {
+        if (!open()) {
+            return false;
+        }
+        char* errmsg = nullptr;
+        int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &errmsg);
+        if (rc != SQLITE_OK) {
+            std::cerr << "SQL error: " << (errmsg != nullptr ? errmsg : sqlite3_errmsg(db_)) << std::endl;
+            sqlite3_free(errmsg);
+            return false;
+        }
+        return true;
+    }
+
+    // Đặt các PRAGMA của settings. Trả về chế độ journal thực sự đang dùng (SQLite giữ nguyên chế độ cũ
+    // nếu không chuyển được, ví dụ sang WAL trên hệ thống tệp không hỗ trợ bộ nhớ dùng chung).
+    std::string configure(const StorageSettings& settings) {
+        if (!open()) {
+            return {};
+        }
+        std::string journal_mode = query_text("PRAGMA journal_mode=" + std::string(settings.journal_mode) + ";");
+        exec(("PRAGMA synchronous=" + std::string(settings.synchronous) + ";"
+              "PRAGMA mmap_size=" + std::to_string(settings.mmap_size) + ";"
+              "PRAGMA cache_size=" + std::to_string(settings.cache_size) + ";"
+              "PRAGMA wal_autocheckpoint=" + std::to_string(settings.wal_autocheckpoint) + ";").c_str());
+        return journal_mode;
+    }
+
+    // Giá trị cột đầu tiên của hàng đầu tiên do sql trả về, hoặc chuỗi rỗng.
+    std::string query_text(const std::string& sql) {
+        if (!open()) {
+            return {};
+        }
+        sqlite3_stmt* stmt = nullptr;
+        std::string result;
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "SQL prepare error: " << sqlite3_errmsg(db_) << std::endl;
+            return result;
+        }
+        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0) != nullptr) {
+            result = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+        return result;
+    }
+
+    // Câu lệnh đã biên dịch cho sql, biên dịch ở lần dùng đầu tiên rồi giữ lại.
+    // Dùng qua Statement để câu lệnh được reset và xóa tham số sau mỗi lần dùng.
+    sqlite3_stmt* prepare(const std::string& sql) {
+        auto it = statements_.find(sql);
+        if (it != statements_.end()) {
+            return it->second;
+        }
+        if (!open()) {
+            return nullptr;
+        }
+
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v3(db_, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "SQL prepare error: " << sqlite3_errmsg(db_) << std::endl;
+            return nullptr;
+        }
+        statements_.emplace(sql, stmt);
+        return stmt;
+    }
+
+private:
+    static constexpr int kBusyTimeoutMs = 5000;
+
+    std::string path_;
+    bool read_only_ = false;
+    sqlite3* db_ = nullptr;
+    std::unordered_map<std::string, sqlite3_stmt*> statements_; // Khóa là câu SQL.
+};
+
+// Mượn một câu lệnh từ bộ nhớ đệm của SqliteConnection trong một phạm vi; khi ra khỏi phạm vi
+// câu lệnh được reset và xóa tham số để lần dùng sau bắt đầu sạch.
+class Statement {
+public:
+    Statement(SqliteConnection& connection, const std::string& sql) : stmt_(connection.prepare(sql)) {}
+
+    ~Statement() {
+        if (stmt_ != nullptr) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+        }
+    }
+
+    Statement(const Statement&) = delete;
+    Statement& operator=(const Statement&) = delete;
+
+    explicit operator bool() const { return stmt_ != nullptr; }
+    sqlite3_stmt* get() const { return stmt_; }
+
+    // Reset để chạy lại với tham số mới trong cùng phạm vi (tham số cũ được giữ cho tới khi bind lại).
+    void reset() { sqlite3_reset(stmt_); }
+
+private:
+    sqlite3_stmt* stmt_;
+};
+
+#endif //DATABASE_SERVER_SQLITE_CONNECTION_H
@@ -0,0 +1,135 @@
+#ifndef DATABASE_SERVER_SQLITE_READ_POOL_H
+#define DATABASE_SERVER_SQLITE_READ_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sqlite_connection.h"
+
+// Nhóm kết nối chỉ đọc tới lora.db cho các truy vấn, tách khỏi kết nối ghi của luồng xử lý. Ở chế độ WAL
+// người đọc không bao giờ chặn người ghi (và ngược lại), nên truy vấn chạy song song trên nhiều lõi mà
+// group commit không phải chờ.
+//
+// Mỗi kết nối giữ bộ nhớ đệm câu lệnh riêng (SqliteConnection::prepare). Một luồng được trả lại kết nối nó
+// dùng lần trước nếu kết nối đó đang rảnh, nên khi số luồng truy vấn không vượt số kết nối, mỗi luồng thực
+// chất có kết nối và câu lệnh biên dịch sẵn của riêng nó, không luồng nào phải biên dịch lại.
+class SqliteReadPool {
+public:
+    // Mượn một kết nối trong một phạm vi; trả lại nhóm khi ra khỏi phạm vi.
+    class Lease {
+    public:
+        Lease(SqliteReadPool& pool, std::size_t index) : pool_(&pool), index_(index) {}
+        ~Lease() {
+            if (pool_ != nullptr) {
+                pool_->release(index_);
+            }
+        }
+
+        Lease(Lease&& other) noexcept : pool_(other.pool_), index_(other.index_) { other.pool_ = nullptr; }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        SqliteConnection& connection() const { return *pool_->connections_[index_]; }
+
+    private:
+        SqliteReadPool* pool_;
+        std::size_t index_;
+    };
+
+    SqliteReadPool(const std::string& path, std::size_t size) {
+        for (std::size_t i = 0; i < std::max<std::size_t>(1, size); ++i) {
+            connections_.push_back(std::make_unique<SqliteConnection>(path, true));
+        }
+        busy_.assign(connections_.size(), false);
+    }
+
+    // Mở mọi kết nối; mmap_size như hồ sơ lưu trữ của kết nối ghi để trang đọc không phải chép qua read().
+    bool open(std::int64_t mmap_size) {
+        for (auto& connection : connections_) {
+            if (!connection->open() || !connection->exec(("PRAGMA mmap_size=" + std::to_string(mmap_size) + ";").c_str())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t size() const { return connections_.size(); }
+
+    // Chờ tới khi có kết nối rảnh.
+    Lease acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::size_t index = take_locked();
+        if (index == kNone) {
+            waits_.fetch_add(1, std::memory_order_relaxed);
+            available_.wait(lock, [&] { return (index = take_locked()) != kNone; });
+        }
+        last_used_ = index;
+        return Lease(*this, index);
+    }
+
+    // Chạy fn(SqliteConnection&) trong một giao dịch đọc: mọi câu lệnh của fn thấy cùng một ảnh chụp WAL,
+    // kể cả khi luồng xử lý commit ở giữa. Trả về false nếu không bắt đầu được giao dịch.
+    template <typename Fn>
+    bool read(Fn&& fn) {
+        Lease lease = acquire();
+        SqliteConnection& db = lease.connection();
+        if (!db.exec("BEGIN;")) {
+            return false;
+        }
+        fn(db);
+        db.exec("COMMIT;"); // Chỉ kết thúc giao dịch đọc.
+        reads_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::uint64_t reads() const { return reads_.load(std::memory_order_relaxed); }
+    std::uint64_t waits() const { return waits_.load(std::memory_order_relaxed); } // Số lần phải chờ kết nối rảnh.
+
+private:
+    static constexpr std::size_t kNone = std::numeric_limits<std::size_t>::max();
+
+    // Ưu tiên kết nối luồng này dùng lần trước (câu lệnh của nó đã được biên dịch trên đó).
+    std::size_t take_locked() {
+        std::size_t index = kNone;
+        if (last_used_ < busy_.size() && !busy_[last_used_]) {
+            index = last_used_;
+        } else {
+            for (std::size_t i = 0; i < busy_.size() && index == kNone; ++i) {
+                if (!busy_[i]) {
+                    index = i;
+                }
+            }
+        }
+        if (index != kNone) {
+            busy_[index] = true;
+        }
+        return index;
+    }
+
+    void release(std::size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_[index] = false;
+        }
+        available_.notify_one();
+    }
+
+    inline static thread_local std::size_t last_used_ = kNone;
+
+    std::vector<std::unique_ptr<SqliteConnection>> connections_;
+    std::vector<bool> busy_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+    std::atomic<std::uint64_t> reads_{0};
+    std::atomic<std::uint64_t> waits_{0};
+};
+
+#endif //DATABASE_SERVER_SQLITE_READ_POOL_H
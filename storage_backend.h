@@ -0,0 +1,55 @@
+#ifndef DATABASE_SERVER_STORAGE_BACKEND_H
+#define DATABASE_SERVER_STORAGE_BACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sensor_data.h"
+
+// Nơi lưu bản ghi cảm biến của LoRaServer, chọn bằng --storage-engine: SqliteBackend (sensor_data trong
+// lora.db), ColumnarBackend (ColumnarStore) hoặc MemoryBackend (chỉ trong bộ nhớ, để đo riêng phần CPU của
+// máy chủ). Máy chủ lo dự đoán, log và lịch sử; backend chỉ lo lưu và đọc lại.
+//
+// Mọi hàm trừ query_range() và report_metrics() chỉ được gọi từ start() và luồng xử lý. query_range() chạy
+// trên các luồng truy vấn, song song với insert_batch(), nên backend tự đồng bộ phần dữ liệu nó đọc.
+// report_metrics() chạy trên luồng in số liệu và chỉ được đọc bộ đếm nguyên tử.
+class StorageBackend {
+public:
+    // Gắn nhãn dự đoán và ghi chú cho một bản ghi trước khi lưu.
+    using Annotate = std::function<void(SensorData&)>;
+
+    virtual ~StorageBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    // Mở nơi lưu và chuẩn bị schema. Trả về false nếu không dùng được; máy chủ sẽ thử SQLite.
+    virtual bool open() = 0;
+
+    // Thêm các luồng nền của backend (checkpoint, dọn dẹp...) vào workers.
+    virtual void start_background(std::vector<std::thread>& /*workers*/) {}
+
+    // Gọi annotate rồi lưu từng bản ghi của lô, commit cả lô một lần. Trả về số bản ghi đã commit.
+    // stored_rows và repeated_rows (có thể nullptr) được gán lại kích thước lô: bản ghi thứ i đã được commit,
+    // và bản ghi thứ i chỉ kéo dài hàng trước của thiết bị (--change-only) nên không qua annotate mà lấy lại
+    // nhãn của hàng đó.
+    virtual std::size_t insert_batch(std::vector<DeviceReading>& batch, const Annotate& annotate,
+                                     std::vector<bool>* stored_rows, std::vector<bool>* repeated_rows) = 0;
+
+    // Gọi fn(temperature) cho mọi bản ghi đã gán nhãn: tập huấn luyện của dự đoán.
+    virtual void scan_training(const std::function<void(double)>& fn) = 0;
+
+    // Gọi fn cho tối đa limit bản ghi đầu tiên của device_id có from_ms <= timestamp_ms <= to_ms, theo thời
+    // gian. Trả về false nếu đọc lỗi (fn có thể đã được gọi cho một phần kết quả).
+    virtual bool query_range(const std::string& device_id, std::int64_t from_ms, std::int64_t to_ms, std::size_t limit,
+                             const std::function<void(const SensorData&)>& fn) = 0;
+
+    // Thêm các dòng "[metrics] ..." của backend.
+    virtual void report_metrics(std::ostream& /*out*/) const {}
+};
+
+#endif //DATABASE_SERVER_STORAGE_BACKEND_H
@@ -0,0 +1,712 @@
+#ifndef DATABASE_SERVER_URING_BACKEND_H
+#define DATABASE_SERVER_URING_BACKEND_H
+
+// Tầng I/O dựa trên io_uring cho Linux, thay cho đường epoll của Asio: accept/recv/send/close của
+// socket TCP và phần ghi nối tiếp log.txt được nộp thành yêu cầu trong vòng gửi dùng chung với nhân,
+// nên nhiều thao tác chỉ tốn một lời gọi io_uring_enter() và việc thu kết quả không cần lời gọi hệ thống.
+// Chỉ được biên dịch khi bật tùy chọn CMake ENABLE_IO_URING (định nghĩa LORA_WITH_IO_URING).
+// Dùng lời gọi hệ thống trực tiếp nên không phụ thuộc liburing; cần nhân 5.6 trở lên.
+
+#ifdef LORA_WITH_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Một vòng io_uring: hàng gửi (SQ) và hàng kết quả (CQ) được ánh xạ vào bộ nhớ dùng chung với nhân.
+// Chỉ một luồng được dùng một vòng.
+class IoUring {
+public:
+    explicit IoUring(unsigned entries) {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+        }
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+        auto* sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_tail_local_ = *sq_tail_;
+
+        auto* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~IoUring() {
+        munmap(sqes_, sqes_size_);
+        if (cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        munmap(sq_ring_, sq_ring_size_);
+        close(fd_);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Lấy một ô trống trong hàng gửi; tự nộp các yêu cầu đang chờ nếu hàng gửi đã đầy.
+    io_uring_sqe* get_sqe() {
+        while (sq_tail_local_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            submit_and_wait(0);
+        }
+        unsigned index = sq_tail_local_ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        ++sq_tail_local_;
+        return sqe;
+    }
+
+    // Nộp mọi yêu cầu đang chờ và chờ ít nhất wait_nr kết quả, trong một lời gọi hệ thống.
+    int submit_and_wait(unsigned wait_nr) {
+        __atomic_store_n(sq_tail_, sq_tail_local_, __ATOMIC_RELEASE);
+        unsigned to_submit = sq_tail_local_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (to_submit == 0 && wait_nr == 0) {
+            return 0;
+        }
+        unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit, wait_nr, flags, nullptr, 0));
+        enter_calls_.fetch_add(1, std::memory_order_relaxed);
+        return ret < 0 ? -errno : ret;
+    }
+
+    // Gọi fn(cqe) cho mọi kết quả đã có mà không cần lời gọi hệ thống. fn được phép nộp yêu cầu mới.
+    template <typename Fn>
+    unsigned drain_completions(Fn&& fn) {
+        unsigned count = 0;
+        unsigned head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = cqes_[head & cq_mask_];
+            __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE); // Trả ô cho nhân trước khi xử lý.
+            fn(cqe);
+            ++count;
+        }
+        return count;
+    }
+
+    std::uint64_t enter_calls() const { return enter_calls_.load(std::memory_order_relaxed); }
+
+private:
+    void* map(std::size_t size, off_t offset) const {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        if (ptr == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "io_uring mmap");
+        }
+        return ptr;
+    }
+
+    int fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    std::size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sq_tail_local_ = 0; // Đuôi hàng gửi phía ứng dụng, chỉ công bố cho nhân khi nộp.
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::atomic<std::uint64_t> enter_calls_{0}; // Đọc từ luồng in số liệu thống kê.
+};
+
+// Vòng sự kiện TCP trên io_uring: một socket lắng nghe, một vòng và một luồng.
+// Mỗi vòng có socket lắng nghe SO_REUSEPORT riêng nên nhân tự chia kết nối giữa các vòng.
+class UringEventLoop {
+public:
+    using ConnectionId = std::uint64_t;
+
+    // Phía giao thức của một kết nối. Mọi hàm được gọi trên luồng của vòng sở hữu kết nối.
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+
+        // Dữ liệu vừa nhận; trả về false để đóng kết nối.
+        virtual bool on_data(const char* data, std::size_t len) = 0;
+
+        // Đối phương đã đóng chiều gửi. Vòng ngừng đọc nhưng vẫn gửi; handler gọi close_after_send() (ngay
+        // trong on_eof() hoặc sau này) khi không còn phản hồi nào sắp tới.
+        virtual void on_eof() = 0;
+
+        // true = tạm ngừng đọc (backpressure). Vòng hỏi lại định kỳ cho tới khi trả về false.
+        virtual bool paused() = 0;
+
+        // Quá thời điểm này mà chưa nhận thêm dữ liệu thì vòng đóng kết nối (kiểm tra mỗi giây).
+        virtual std::chrono::steady_clock::time_point deadline() = 0;
+
+        // Kết nối bắt đầu đóng; expired = true nếu do quá hạn đọc. Gọi đúng một lần.
+        virtual void on_close(bool expired) = 0;
+    };
+
+    // Trả về nullptr để từ chối kết nối; socket được đóng ngay.
+    using HandlerFactory = std::function<std::shared_ptr<Handler>(UringEventLoop&, ConnectionId, std::string client_ip)>;
+
+    UringEventLoop(const std::string& ip, unsigned short port, HandlerFactory factory, unsigned entries = 4096)
+            : ring_(entries), factory_(std::move(factory)) {
+        listen_fd_ = open_listen_socket(ip, port);
+        wake_fd_ = eventfd(0, EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+    }
+
+    ~UringEventLoop() {
+        close(wake_fd_);
+        close(listen_fd_);
+    }
+
+    // Chạy vòng sự kiện trên luồng hiện tại; không bao giờ trả về.
+    void run() {
+        arm_accept();
+        arm_wake();
+        while (true) {
+            int ret = ring_.submit_and_wait(1);
+            if (ret < 0 && ret != -EINTR && ret != -EBUSY && ret != -EAGAIN) {
+                throw std::system_error(-ret, std::generic_category(), "io_uring_enter");
+            }
+            ring_.drain_completions([this](const io_uring_cqe& cqe) { handle_completion(cqe); });
+        }
+    }
+
+    // Gửi dữ liệu trên kết nối; chỉ gọi trên luồng của vòng. Bỏ qua nếu kết nối đã đóng.
+    void send(ConnectionId id, std::string data) {
+        auto it = connections_.find(id);
+        if (it == connections_.end() || it->second->closing) {
+            return;
+        }
+        Conn& conn = *it->second;
+        conn.outbox.push_back(std::move(data));
+        if (!conn.send_in_flight) {
+            arm_send(id, conn);
+        }
+    }
+
+    // Đóng kết nối khi outbox đã gửi hết; chỉ gọi trên luồng của vòng.
+    void close_after_send(ConnectionId id) {
+        auto it = connections_.find(id);
+        if (it == connections_.end() || it->second->closing) {
+            return;
+        }
+        Conn& conn = *it->second;
+        conn.close_after_send = true;
+        if (!conn.send_in_flight) {
+            begin_close(id, conn);
+        }
+    }
+
+    // Chạy task trên luồng của vòng; gọi được từ bất kỳ luồng nào.
+    void post(std::function<void()> task) {
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex_);
+            was_empty = tasks_.empty();
+            tasks_.push_back(std::move(task));
+        }
+        if (was_empty) {
+            // Chỉ đánh thức một lần cho mỗi đợt task; vòng lấy hết task khi thức dậy.
+            std::uint64_t one = 1;
+            [[maybe_unused]] ssize_t written = write(wake_fd_, &one, sizeof(one));
+        }
+    }
+
+    std::uint64_t enter_calls() const { return ring_.enter_calls(); }
+    std::uint64_t accepted() const { return accepted_.load(std::memory_order_relaxed); }
+
+private:
+    enum Op : std::uint64_t { Accept = 1, Recv, Send, Close, Wake, Timeout, Sweep };
+
+    static constexpr int kOpShift = 56; // user_data = (thao tác << 56) | ID kết nối.
+    static constexpr std::size_t kRecvBufferSize = 1024;
+
+    struct Conn {
+        int fd = -1;
+        std::shared_ptr<Handler> handler;
+        std::array<char, kRecvBufferSize> buffer{};
+        std::deque<std::string> outbox; // Phần tử đầu đang được gửi; deque giữ nguyên địa chỉ khi thêm vào cuối.
+        std::size_t sent = 0; // Số byte của phần tử đầu đã được gửi.
+        bool recv_in_flight = false;
+        bool send_in_flight = false;
+        bool paused = false;
+        bool closing = false;
+        bool close_after_send = false; // Đóng khi outbox trống (sau EOF).
+    };
+
+    static std::uint64_t tag(Op op, ConnectionId id) { return (static_cast<std::uint64_t>(op) << kOpShift) | id; }
+
+    void handle_completion(const io_uring_cqe& cqe) {
+        auto op = static_cast<Op>(cqe.user_data >> kOpShift);
+        ConnectionId id = cqe.user_data & ((std::uint64_t{1} << kOpShift) - 1);
+
+        switch (op) {
+            case Accept:
+                on_accept(cqe.res);
+                break;
+            case Recv:
+                on_recv(id, cqe.res);
+                break;
+            case Send:
+                on_send(id, cqe.res);
+                break;
+            case Wake:
+                on_wake();
+                break;
+            case Timeout:
+                on_timeout();
+                break;
+            case Sweep:
+                on_sweep();
+                break;
+            case Close:
+                break;
+        }
+    }
+
+    void on_accept(int res) {
+        arm_accept(); // Chỉ một accept chờ tại một thời điểm, vì địa chỉ nhận là thành viên của vòng.
+        if (res < 0) {
+            return;
+        }
+
+        char address[INET6_ADDRSTRLEN] = {};
+        if (accept_address_.ss_family == AF_INET6) {
+            inet_ntop(AF_INET6, &reinterpret_cast<sockaddr_in6&>(accept_address_).sin6_addr, address, sizeof(address));
+        } else {
+            inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in&>(accept_address_).sin_addr, address, sizeof(address));
+        }
+
+        ConnectionId id = ++last_id_;
+        auto conn = std::make_unique<Conn>();
+        conn->fd = res;
+        conn->handler = factory_(*this, id, address);
+        if (!conn->handler) {
+            submit_close(id, res);
+            return;
+        }
+        Conn& ref = *conn;
+        connections_.emplace(id, std::move(conn));
+        accepted_.fetch_add(1, std::memory_order_relaxed);
+        arm_recv(id, ref);
+        arm_sweep();
+    }
+
+    void on_recv(ConnectionId id, int res) {
+        auto it = connections_.find(id);
+        if (it == connections_.end()) {
+            return;
+        }
+        Conn& conn = *it->second;
+        conn.recv_in_flight = false;
+
+        if (conn.closing) {
+            finish_close(id, conn);
+            return;
+        }
+        if (res == -EINTR || res == -EAGAIN) {
+            arm_recv(id, conn);
+            return;
+        }
+        if (res == 0) {
+            // Không đọc tiếp; handler gọi close_after_send() khi đã trả lời xong, có thể ngay trong on_eof() và
+            // khi đó conn bị xóa, nên giữ handler sống tới hết lời gọi.
+            std::shared_ptr<Handler> handler = conn.handler;
+            handler->on_eof();
+            return;
+        }
+        if (res < 0) {
+            begin_close(id, conn);
+            return;
+        }
+
+        if (!conn.handler->on_data(conn.buffer.data(), static_cast<std::size_t>(res))) {
+            begin_close(id, conn);
+            return;
+        }
+        if (conn.handler->paused()) {
+            conn.paused = true; // Hàng đợi quá tải: tạm ngừng đọc.
+            paused_.push_back(id);
+            arm_timeout();
+        } else {
+            arm_recv(id, conn); // Tiếp tục đọc trên cùng kết nối.
+        }
+    }
+
+    void on_send(ConnectionId id, int res) {
+        auto it = connections_.find(id);
+        if (it == connections_.end()) {
+            return;
+        }
+        Conn& conn = *it->second;
+        conn.send_in_flight = false;
+
+        if (res < 0 || conn.closing) {
+            begin_close(id, conn);
+            return;
+        }
+        conn.sent += static_cast<std::size_t>(res);
+        if (conn.sent == conn.outbox.front().size()) {
+            conn.outbox.pop_front();
+            conn.sent = 0;
+        }
+        if (!conn.outbox.empty()) {
+            arm_send(id, conn);
+        } else if (conn.close_after_send) {
+            begin_close(id, conn);
+        }
+    }
+
+    void on_wake() {
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex_);
+            tasks.swap(tasks_);
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+        arm_wake();
+    }
+
+    // Kiểm tra lại các kết nối đang tạm ngừng đọc.
+    void on_timeout() {
+        timeout_armed_ = false;
+        std::vector<ConnectionId> still_paused;
+        for (ConnectionId id : paused_) {
+            auto it = connections_.find(id);
+            if (it == connections_.end()) {
+                continue;
+            }
+            Conn& conn = *it->second;
+            if (conn.closing) {
+                continue;
+            }
+            if (conn.handler->paused()) {
+                still_paused.push_back(id);
+            } else {
+                conn.paused = false;
+                arm_recv(id, conn);
+            }
+        }
+        paused_.swap(still_paused);
+        if (!paused_.empty()) {
+            arm_timeout();
+        }
+    }
+
+    // Đóng các kết nối quá hạn đọc; lặp lại mỗi giây khi còn kết nối.
+    void on_sweep() {
+        sweep_armed_ = false;
+        auto now = std::chrono::steady_clock::now();
+        std::vector<ConnectionId> expired;
+        for (auto& [id, conn] : connections_) {
+            if (!conn->closing && conn->handler->deadline() <= now) {
+                expired.push_back(id);
+            }
+        }
+        for (ConnectionId id : expired) {
+            auto it = connections_.find(id);
+            if (it != connections_.end()) {
+                begin_close(id, *it->second, true);
+            }
+        }
+        if (!connections_.empty()) {
+            arm_sweep();
+        }
+    }
+
+    // Đóng kết nối khi không còn thao tác nào của nó đang chờ trong nhân.
+    void begin_close(ConnectionId id, Conn& conn, bool expired = false) {
+        if (!conn.closing) {
+            conn.closing = true;
+            conn.handler->on_close(expired);
+        }
+        if (conn.recv_in_flight) {
+            shutdown(conn.fd, SHUT_RDWR); // Buộc recv đang chờ hoàn tất; việc đóng tiếp tục trong on_recv().
+            return;
+        }
+        finish_close(id, conn);
+    }
+
+    void finish_close(ConnectionId id, Conn& conn) {
+        if (conn.recv_in_flight || conn.send_in_flight) {
+            return;
+        }
+        submit_close(id, conn.fd);
+        connections_.erase(id);
+    }
+
+    void submit_close(ConnectionId id, int fd) {
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fd;
+        sqe->user_data = tag(Close, id);
+    }
+
+    void arm_accept() {
+        accept_address_len_ = sizeof(accept_address_);
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listen_fd_;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&accept_address_);
+        sqe->addr2 = reinterpret_cast<std::uint64_t>(&accept_address_len_);
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = tag(Accept, 0);
+    }
+
+    void arm_recv(ConnectionId id, Conn& conn) {
+        conn.recv_in_flight = true;
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = conn.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(conn.buffer.data());
+        sqe->len = static_cast<std::uint32_t>(conn.buffer.size());
+        sqe->user_data = tag(Recv, id);
+    }
+
+    void arm_send(ConnectionId id, Conn& conn) {
+        const std::string& front = conn.outbox.front();
+        conn.send_in_flight = true;
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(front.data() + conn.sent);
+        sqe->len = static_cast<std::uint32_t>(front.size() - conn.sent);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = tag(Send, id);
+    }
+
+    void arm_wake() {
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wake_fd_;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&wake_value_);
+        sqe->len = sizeof(wake_value_);
+        sqe->user_data = tag(Wake, 0);
+    }
+
+    void arm_timeout() {
+        if (timeout_armed_) {
+            return;
+        }
+        timeout_armed_ = true;
+        timeout_ = {0, 10 * 1000 * 1000}; // 10 ms, như bộ định thời backpressure của Asio.
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&timeout_);
+        sqe->len = 1;
+        sqe->user_data = tag(Timeout, 0);
+    }
+
+    void arm_sweep() {
+        if (sweep_armed_) {
+            return;
+        }
+        sweep_armed_ = true;
+        sweep_interval_ = {1, 0};
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&sweep_interval_);
+        sqe->len = 1;
+        sqe->user_data = tag(Sweep, 0);
+    }
+
+    static int open_listen_socket(const std::string& ip, unsigned short port) {
+        sockaddr_storage address{};
+        socklen_t address_len;
+        auto& v4 = reinterpret_cast<sockaddr_in&>(address);
+        auto& v6 = reinterpret_cast<sockaddr_in6&>(address);
+        if (inet_pton(AF_INET, ip.c_str(), &v4.sin_addr) == 1) {
+            v4.sin_family = AF_INET;
+            v4.sin_port = htons(port);
+            address_len = sizeof(v4);
+        } else if (inet_pton(AF_INET6, ip.c_str(), &v6.sin6_addr) == 1) {
+            v6.sin6_family = AF_INET6;
+            v6.sin6_port = htons(port);
+            address_len = sizeof(v6);
+        } else {
+            throw std::system_error(EINVAL, std::generic_category(), "invalid listen address " + ip);
+        }
+
+        int fd = socket(address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "socket");
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), address_len) < 0 || listen(fd, SOMAXCONN) < 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "bind/listen");
+        }
+        return fd;
+    }
+
+    IoUring ring_;
+    HandlerFactory factory_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1; // eventfd đánh thức vòng khi có task từ luồng khác.
+    std::uint64_t wake_value_ = 0;
+
+    sockaddr_storage accept_address_{};
+    socklen_t accept_address_len_ = 0;
+    ConnectionId last_id_ = 0;
+    std::unordered_map<ConnectionId, std::unique_ptr<Conn>> connections_;
+
+    std::vector<ConnectionId> paused_; // Kết nối đang tạm ngừng đọc vì backpressure.
+    __kernel_timespec timeout_{};
+    bool timeout_armed_ = false;
+    __kernel_timespec sweep_interval_{}; // Chu kỳ kiểm tra hạn đọc.
+    bool sweep_armed_ = false;
+
+    std::mutex tasks_mutex_;
+    std::vector<std::function<void()>> tasks_;
+    std::atomic<std::uint64_t> accepted_{0};
+};
+
+// Ghi nối tiếp vào một tệp qua io_uring. Tệp được mở một lần; mỗi lần append() nộp một yêu cầu ghi tại
+// vị trí tự theo dõi (nên các lần ghi có thể hoàn tất theo thứ tự bất kỳ) và thu kết quả các lần trước
+// mà không chờ. Chỉ một luồng được dùng một đối tượng.
+class UringFileAppender {
+public:
+    explicit UringFileAppender(const char* path, unsigned entries = 256) : ring_(entries) {
+        fd_ = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), std::string("open ") + path);
+        }
+        struct stat st{};
+        fstat(fd_, &st);
+        offset_ = static_cast<std::uint64_t>(st.st_size);
+    }
+
+    ~UringFileAppender() {
+        while (!in_flight_.empty()) {
+            ring_.submit_and_wait(1);
+            reap();
+        }
+        close(fd_);
+    }
+
+    UringFileAppender(const UringFileAppender&) = delete;
+    UringFileAppender& operator=(const UringFileAppender&) = delete;
+
+    void append(std::string data) {
+        if (data.empty()) {
+            return;
+        }
+        reap();
+        std::uint64_t offset = offset_;
+        offset_ += data.size();
+        submit_write(std::move(data), offset);
+        ring_.submit_and_wait(0);
+        writes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t enter_calls() const { return ring_.enter_calls(); }
+    std::uint64_t writes() const { return writes_.load(std::memory_order_relaxed); }
+
+private:
+    struct PendingWrite {
+        std::string data; // Phải sống tới khi nhân báo hoàn tất.
+        std::uint64_t offset = 0;
+    };
+
+    void submit_write(std::string data, std::uint64_t offset) {
+        std::uint64_t key = ++last_key_;
+        PendingWrite& pending = in_flight_[key];
+        pending.data = std::move(data);
+        pending.offset = offset;
+
+        io_uring_sqe* sqe = ring_.get_sqe();
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fd_;
+        sqe->addr = reinterpret_cast<std::uint64_t>(pending.data.data());
+        sqe->len = static_cast<std::uint32_t>(pending.data.size());
+        sqe->off = offset;
+        sqe->user_data = key;
+    }
+
+    // Thu kết quả đã có; ghi thiếu thì nộp lại phần còn lại tại đúng vị trí.
+    void reap() {
+        ring_.drain_completions([this](const io_uring_cqe& cqe) {
+            auto it = in_flight_.find(cqe.user_data);
+            if (it == in_flight_.end()) {
+                return;
+            }
+            PendingWrite pending = std::move(it->second);
+            in_flight_.erase(it);
+
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                submit_write(std::move(pending.data), pending.offset);
+            } else if (cqe.res < 0) {
+                std::error_code error(-cqe.res, std::generic_category());
+                std::fprintf(stderr, "log append failed: %s\n", error.message().c_str());
+            } else if (static_cast<std::size_t>(cqe.res) < pending.data.size()) {
+                submit_write(pending.data.substr(static_cast<std::size_t>(cqe.res)), pending.offset + cqe.res);
+            }
+        });
+    }
+
+    IoUring ring_;
+    int fd_ = -1;
+    std::uint64_t offset_ = 0; // Vị trí ghi tiếp theo (cuối tệp sau mọi lần ghi đã nộp).
+    std::uint64_t last_key_ = 0;
+    std::unordered_map<std::uint64_t, PendingWrite> in_flight_;
+    std::atomic<std::uint64_t> writes_{0};
+};
+
+#endif // LORA_WITH_IO_URING
+
+#endif //DATABASE_SERVER_URING_BACKEND_H
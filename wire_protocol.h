@@ -0,0 +1,215 @@
+#ifndef DATABASE_SERVER_WIRE_PROTOCOL_H
+#define DATABASE_SERVER_WIRE_PROTOCOL_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// Khung nhị phân có bố cục cố định cho bản ghi cảm biến, dùng song song với định dạng văn bản "id:v v v v".
+// Kết nối được coi là nhị phân khi byte đầu tiên là kBinaryMagicV1, kBatchMagicV1 hoặc kSequencedMagicV1.
+// Mọi số nguyên và số thực đều little-endian.
+//
+// Khung đơn:  [0xB1] + một mục
+// Khung lô:   [0xB2] + u16 số mục + các mục nối tiếp nhau
+// Khung có số thứ tự: [0xB3] + u32 số thứ tự + một khung đơn hoặc khung lô; máy chủ xác nhận bằng "ACK n"/"NAK n"
+//
+// Một mục:
+//   [0]     cờ (kFlag*)
+//   tiếp    định danh thiết bị:
+//             - mặc định:          u8 độ dài + các byte ID
+//             - kFlagInternDefine: u16 slot + u8 độ dài + các byte ID (gán ID cho slot trên kết nối này)
+//             - kFlagInternRef:    u16 slot (dùng lại ID đã gán trước đó)
+//   tiếp    4 giá trị light, temperature, air, soil: float32, hoặc float64 nếu có kFlagFloat64
+//   tiếp    i64 dấu thời gian của thiết bị (mili giây epoch UTC, 0 = dùng giờ máy chủ)
+class WireProtocol {
+public:
+    static_assert(std::endian::native == std::endian::little, "Binary frames are decoded in place as little-endian.");
+
+    static constexpr unsigned char kBinaryMagicV1 = 0xB1;
+    static constexpr unsigned char kBatchMagicV1 = 0xB2;
+    static constexpr unsigned char kSequencedMagicV1 = 0xB3;
+
+    static constexpr unsigned char kFlagFloat64 = 0x01;
+    static constexpr unsigned char kFlagInternDefine = 0x02;
+    static constexpr unsigned char kFlagInternRef = 0x04;
+
+    static constexpr std::size_t kMaxInternSlots = 1024; // Số slot ID tối đa trên một kết nối.
+    static constexpr std::size_t kMaxBatchEntries = 1024; // Số mục tối đa trong một khung lô.
+
+    static constexpr std::size_t kNeedMoreData = 0; // Kết quả của binary_frame_size(): chưa đủ byte.
+    static constexpr std::size_t kInvalidFrame = static_cast<std::size_t>(-1); // Kết quả: khung hỏng.
+
+    // Một bản ghi đã giải mã. device_id trỏ thẳng vào bộ đệm nhận nên chỉ hợp lệ trong lúc xử lý khung.
+    struct BinaryReading {
+        std::string_view device_id; // Rỗng khi khung chỉ tham chiếu slot (kFlagInternRef).
+        bool defines_slot = false;
+        bool references_slot = false;
+        std::uint16_t slot = 0;
+        double values[4]{}; // light, temperature, air humidity, soil humidity.
+        std::int64_t device_timestamp_ms = 0;
+    };
+
+    static bool is_binary_magic(unsigned char byte) {
+        return byte == kBinaryMagicV1 || byte == kBatchMagicV1 || byte == kSequencedMagicV1;
+    }
+
+    // Nếu frame là khung có số thứ tự, lấy số thứ tự và thu frame lại thành khung bên trong.
+    static bool unwrap_sequence(std::string_view& frame, std::uint32_t& sequence) {
+        if (frame.size() < 5 || static_cast<unsigned char>(frame[0]) != kSequencedMagicV1) {
+            return false;
+        }
+        read_le(frame.data() + 1, sequence);
+        frame.remove_prefix(5);
+        return true;
+    }
+
+    static bool is_batch(std::string_view frame) {
+        return !frame.empty() && static_cast<unsigned char>(frame[0]) == kBatchMagicV1;
+    }
+
+    // Tính kích thước của khung (đơn hoặc lô) bắt đầu ở đầu data mà không giải mã nó.
+    static std::size_t binary_frame_size(std::string_view data) {
+        if (data.empty()) {
+            return kNeedMoreData;
+        }
+
+        auto magic = static_cast<unsigned char>(data[0]);
+        if (magic == kSequencedMagicV1) {
+            if (data.size() < 6) {
+                return kNeedMoreData;
+            }
+            if (static_cast<unsigned char>(data[5]) == kSequencedMagicV1) {
+                return kInvalidFrame; // Không lồng khung có số thứ tự.
+            }
+            std::size_t size = binary_frame_size(data.substr(5));
+            return size == kNeedMoreData || size == kInvalidFrame ? size : size + 5;
+        }
+        if (magic == kBinaryMagicV1) {
+            std::size_t size = entry_size(data.substr(1));
+            return size == kNeedMoreData || size == kInvalidFrame ? size : size + 1;
+        }
+        if (magic != kBatchMagicV1) {
+            return kInvalidFrame;
+        }
+
+        if (data.size() < 3) {
+            return kNeedMoreData;
+        }
+        std::uint16_t count;
+        read_le(data.data() + 1, count);
+        if (count == 0 || count > kMaxBatchEntries) {
+            return kInvalidFrame;
+        }
+
+        std::size_t size = 3;
+        for (std::uint16_t i = 0; i < count; ++i) {
+            std::size_t entry = entry_size(data.substr(size));
+            if (entry == kNeedMoreData || entry == kInvalidFrame) {
+                return entry;
+            }
+            size += entry;
+        }
+        return size;
+    }
+
+    // Giải mã một khung đơn hoàn chỉnh (đã được binary_frame_size() xác nhận kích thước).
+    static bool decode_binary_reading(std::string_view frame, BinaryReading& out) {
+        if (frame.empty() || static_cast<unsigned char>(frame[0]) != kBinaryMagicV1 ||
+            binary_frame_size(frame) != frame.size()) {
+            return false;
+        }
+        return decode_entry(frame.data() + 1, out) != nullptr;
+    }
+
+    // Giải mã mọi mục của một khung lô hoàn chỉnh vào out (được xóa trước khi ghi).
+    static bool decode_batch(std::string_view frame, std::vector<BinaryReading>& out) {
+        out.clear();
+        if (!is_batch(frame) || binary_frame_size(frame) != frame.size()) {
+            return false;
+        }
+
+        std::uint16_t count;
+        const char* p = read_le(frame.data() + 1, count);
+        out.resize(count);
+        for (BinaryReading& reading : out) {
+            p = decode_entry(p, reading);
+            if (p == nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    // Kích thước của một mục bắt đầu bằng byte cờ.
+    static std::size_t entry_size(std::string_view data) {
+        if (data.empty()) {
+            return kNeedMoreData;
+        }
+        auto flags = static_cast<unsigned char>(data[0]);
+        if ((flags & ~(kFlagFloat64 | kFlagInternDefine | kFlagInternRef)) != 0 ||
+            ((flags & kFlagInternDefine) && (flags & kFlagInternRef))) {
+            return kInvalidFrame;
+        }
+
+        std::size_t size = 1;
+        if (flags & (kFlagInternDefine | kFlagInternRef)) {
+            size += 2;
+        }
+        if (!(flags & kFlagInternRef)) {
+            if (data.size() < size + 1) {
+                return kNeedMoreData;
+            }
+            auto id_len = static_cast<unsigned char>(data[size]);
+            if (id_len == 0) {
+                return kInvalidFrame;
+            }
+            size += 1 + id_len;
+        }
+        size += 4 * ((flags & kFlagFloat64) ? sizeof(double) : sizeof(float)) + sizeof(std::int64_t);
+
+        return data.size() < size ? kNeedMoreData : size;
+    }
+
+    // Giải mã một mục đã được entry_size() xác nhận; trả về con trỏ ngay sau mục, hoặc nullptr nếu slot sai.
+    static const char* decode_entry(const char* p, BinaryReading& out) {
+        auto flags = static_cast<unsigned char>(*p++);
+
+        out.defines_slot = flags & kFlagInternDefine;
+        out.references_slot = flags & kFlagInternRef;
+        out.device_id = {};
+        if (out.defines_slot || out.references_slot) {
+            p = read_le(p, out.slot);
+            if (out.slot >= kMaxInternSlots) {
+                return nullptr;
+            }
+        }
+        if (!out.references_slot) {
+            auto id_len = static_cast<unsigned char>(*p++);
+            out.device_id = std::string_view(p, id_len);
+            p += id_len;
+        }
+
+        for (double& value : out.values) {
+            if (flags & kFlagFloat64) {
+                p = read_le(p, value);
+            } else {
+                float narrow;
+                p = read_le(p, narrow);
+                value = narrow;
+            }
+        }
+        return read_le(p, out.device_timestamp_ms);
+    }
+
+    template <typename T>
+    static const char* read_le(const char* p, T& value) {
+        std::memcpy(&value, p, sizeof(T)); // Khung không căn lề nên phải memcpy thay vì ép kiểu con trỏ.
+        return p + sizeof(T);
+    }
+};
+
+#endif //DATABASE_SERVER_WIRE_PROTOCOL_H